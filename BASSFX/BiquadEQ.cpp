@@ -0,0 +1,420 @@
+#include "BiquadEQ.h"
+
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define BIQUAD_SSE
+#include <xmmintrin.h>
+#endif
+
+#ifdef __AVX__
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// FTZ | DAZ, the feedback path of a biquad decays into denormals on silence
+class DenormalGuard
+{
+public:
+    DenormalGuard()
+    {
+        #ifdef BIQUAD_SSE
+        csr = _mm_getcsr();
+        _mm_setcsr(csr | 0x8040);
+        #endif
+    }
+    ~DenormalGuard()
+    {
+        #ifdef BIQUAD_SSE
+        _mm_setcsr(csr);
+        #endif
+    }
+
+private:
+    unsigned int csr = 0;
+};
+
+typedef float BiquadState[BIQUAD_MAX_CHANNELS];
+
+#ifndef BIQUAD_SSE
+// no FTZ without SSE, a DC far below hearing keeps the state out of denormals
+const float ANTI_DENORMAL = 1e-18f;
+#endif
+
+// N bands run back to back inside one frame loop, their feedback chains are
+// independent so the CPU overlaps them instead of waiting on each recursion.
+#ifdef BIQUAD_SSE
+template<int N>
+inline void cascadeSSE(float *data, int frames, int stride, int lane, const int *band,
+                       const float *b0, const float *b1, const float *b2,
+                       const float *a1, const float *a2, BiquadState *s1, BiquadState *s2)
+{
+    __m128 c0[N], c1[N], c2[N], d1[N], d2[N], z1[N], z2[N];
+
+    for (int k=0; k<N; k++)
+    {
+        const int b = band[k];
+        c0[k] = _mm_set1_ps(b0[b]);
+        c1[k] = _mm_set1_ps(b1[b]);
+        c2[k] = _mm_set1_ps(b2[b]);
+        d1[k] = _mm_set1_ps(a1[b]);
+        d2[k] = _mm_set1_ps(a2[b]);
+        z1[k] = _mm_loadu_ps(s1[b] + lane);
+        z2[k] = _mm_loadu_ps(s2[b] + lane);
+    }
+
+    float *p = data + lane;
+    for (int i=0; i<frames; i++, p += stride)
+    {
+        __m128 x = _mm_loadu_ps(p);
+        for (int k=0; k<N; k++)
+        {
+            __m128 y = _mm_add_ps(_mm_mul_ps(c0[k], x), z1[k]);
+            z1[k] = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(c1[k], x), _mm_mul_ps(d1[k], y)), z2[k]);
+            z2[k] = _mm_sub_ps(_mm_mul_ps(c2[k], x), _mm_mul_ps(d2[k], y));
+            x = y;
+        }
+        _mm_storeu_ps(p, x);
+    }
+
+    for (int k=0; k<N; k++)
+    {
+        _mm_storeu_ps(s1[band[k]] + lane, z1[k]);
+        _mm_storeu_ps(s2[band[k]] + lane, z2[k]);
+    }
+}
+#endif
+
+#ifdef __AVX__
+template<int N>
+inline void cascadeAVX(float *data, int frames, const int *band,
+                       const float *b0, const float *b1, const float *b2,
+                       const float *a1, const float *a2, BiquadState *s1, BiquadState *s2)
+{
+    __m256 c0[N], c1[N], c2[N], d1[N], d2[N], z1[N], z2[N];
+
+    for (int k=0; k<N; k++)
+    {
+        const int b = band[k];
+        c0[k] = _mm256_set1_ps(b0[b]);
+        c1[k] = _mm256_set1_ps(b1[b]);
+        c2[k] = _mm256_set1_ps(b2[b]);
+        d1[k] = _mm256_set1_ps(a1[b]);
+        d2[k] = _mm256_set1_ps(a2[b]);
+        z1[k] = _mm256_loadu_ps(s1[b]);
+        z2[k] = _mm256_loadu_ps(s2[b]);
+    }
+
+    float *p = data;
+    for (int i=0; i<frames; i++, p += 8)
+    {
+        __m256 x = _mm256_loadu_ps(p);
+        for (int k=0; k<N; k++)
+        {
+            __m256 y = _mm256_add_ps(_mm256_mul_ps(c0[k], x), z1[k]);
+            z1[k] = _mm256_add_ps(_mm256_sub_ps(_mm256_mul_ps(c1[k], x), _mm256_mul_ps(d1[k], y)), z2[k]);
+            z2[k] = _mm256_sub_ps(_mm256_mul_ps(c2[k], x), _mm256_mul_ps(d2[k], y));
+            x = y;
+        }
+        _mm256_storeu_ps(p, x);
+    }
+
+    for (int k=0; k<N; k++)
+    {
+        _mm256_storeu_ps(s1[band[k]], z1[k]);
+        _mm256_storeu_ps(s2[band[k]], z2[k]);
+    }
+}
+#endif
+
+}
+
+BiquadEQ::BiquadEQ(const float *centers, int bandCount, float bandwidth)
+{
+    nBands = bandCount > BIQUAD_MAX_BANDS ? BIQUAD_MAX_BANDS : bandCount;
+    bw = bandwidth;
+
+    for (int i=0; i<nBands; i++)
+    {
+        centerFreq[i] = centers[i];
+        pendingGain[i] = 0;
+        curGain[i] = 0;
+    }
+
+    dirty = true;
+    clearState = true;
+
+    std::memset(s1, 0, sizeof(s1));
+    std::memset(s2, 0, sizeof(s2));
+}
+
+BiquadEQ::~BiquadEQ()
+{
+}
+
+float BiquadEQ::gain(int band)
+{
+    if (band < 0 || band >= nBands)
+        return 0;
+
+    std::lock_guard<std::mutex> lock(gainMutex);
+    return pendingGain[band];
+}
+
+void BiquadEQ::setGain(int band, float gain)
+{
+    if (band < 0 || band >= nBands)
+        return;
+
+    std::lock_guard<std::mutex> lock(gainMutex);
+    if (pendingGain[band] == gain)
+        return;
+
+    pendingGain[band] = gain;
+    dirty = true;
+}
+
+void BiquadEQ::reset()
+{
+    clearState = true;
+}
+
+void BiquadEQ::updateCoefficients(float sampleRate)
+{
+    const double ln2 = 0.69314718055994530942;
+    const double pi = 3.14159265358979323846;
+
+    activeCount = 0;
+
+    for (int i=0; i<nBands; i++)
+    {
+        // 0 dB is a unity filter, the band is skipped and restart from rest
+        if (curGain[i] == 0 || centerFreq[i] >= sampleRate * 0.49f)
+        {
+            std::memset(s1[i], 0, sizeof(s1[i]));
+            std::memset(s2[i], 0, sizeof(s2[i]));
+            continue;
+        }
+
+        double A = std::pow(10.0, curGain[i] / 40.0);
+        double w0 = 2.0 * pi * centerFreq[i] / sampleRate;
+        double sn = std::sin(w0);
+        double cs = std::cos(w0);
+        double alpha = sn * std::sinh(ln2 / 2.0 * bw * w0 / sn);
+        double a0 = 1.0 + alpha / A;
+
+        b0[i] = static_cast<float>((1.0 + alpha * A) / a0);
+        b1[i] = static_cast<float>((-2.0 * cs) / a0);
+        b2[i] = static_cast<float>((1.0 - alpha * A) / a0);
+        a1[i] = static_cast<float>((-2.0 * cs) / a0);
+        a2[i] = static_cast<float>((1.0 - alpha / A) / a0);
+
+        active[activeCount++] = i;
+    }
+}
+
+bool BiquadEQ::prepare(float sampleRate)
+{
+    if (clearState.exchange(false))
+    {
+        std::memset(s1, 0, sizeof(s1));
+        std::memset(s2, 0, sizeof(s2));
+    }
+
+    bool rateChanged = sampleRate != rate;
+
+    // never block the mixer thread, a missed update is picked up next buffer
+    if (dirty && gainMutex.try_lock())
+    {
+        std::memcpy(curGain, pendingGain, sizeof(curGain));
+        dirty = false;
+        gainMutex.unlock();
+
+        rate = sampleRate;
+        updateCoefficients(sampleRate);
+    }
+    else if (rateChanged)
+    {
+        rate = sampleRate;
+        updateCoefficients(sampleRate);
+    }
+
+    return activeCount > 0;
+}
+
+void BiquadEQ::runCascade(float *data, int frames, int lanes)
+{
+    #if defined(__AVX__)
+    if (lanes == 8)
+    {
+        for (int k=0; k<activeCount; k += 4)
+        {
+            const int *band = active + k;
+            switch (activeCount - k)
+            {
+            case 1:  cascadeAVX<1>(data, frames, band, b0, b1, b2, a1, a2, s1, s2); break;
+            case 2:  cascadeAVX<2>(data, frames, band, b0, b1, b2, a1, a2, s1, s2); break;
+            case 3:  cascadeAVX<3>(data, frames, band, b0, b1, b2, a1, a2, s1, s2); break;
+            default: cascadeAVX<4>(data, frames, band, b0, b1, b2, a1, a2, s1, s2); break;
+            }
+        }
+        return;
+    }
+    #endif
+
+    #ifdef BIQUAD_SSE
+    for (int lane=0; lane<lanes; lane += 4)
+    {
+        for (int k=0; k<activeCount; k += 4)
+        {
+            const int *band = active + k;
+            switch (activeCount - k)
+            {
+            case 1:  cascadeSSE<1>(data, frames, lanes, lane, band, b0, b1, b2, a1, a2, s1, s2); break;
+            case 2:  cascadeSSE<2>(data, frames, lanes, lane, band, b0, b1, b2, a1, a2, s1, s2); break;
+            case 3:  cascadeSSE<3>(data, frames, lanes, lane, band, b0, b1, b2, a1, a2, s1, s2); break;
+            default: cascadeSSE<4>(data, frames, lanes, lane, band, b0, b1, b2, a1, a2, s1, s2); break;
+            }
+        }
+    }
+    #else
+    for (int k=0; k<activeCount; k++)
+    {
+        const int b = active[k];
+
+        for (int c=0; c<lanes; c++)
+        {
+            float z1 = s1[b][c];
+            float z2 = s2[b][c];
+
+            float *p = data + c;
+            for (int i=0; i<frames; i++, p += lanes)
+            {
+                float x = *p + ANTI_DENORMAL;
+                float y = b0[b] * x + z1;
+                z1 = b1[b] * x - a1[b] * y + z2;
+                z2 = b2[b] * x - a2[b] * y;
+                *p = y;
+            }
+
+            s1[b][c] = z1;
+            s2[b][c] = z2;
+        }
+    }
+    #endif
+}
+
+void BiquadEQ::process(float *buffer, int frames, int channels, float sampleRate)
+{
+    if (channels < 1 || channels > BIQUAD_MAX_CHANNELS || frames < 1)
+        return;
+
+    DenormalGuard guard;
+
+    if (!prepare(sampleRate))
+        return;
+
+    const int lanes = channels > 4 ? 8 : 4;
+
+    // 4 and 8 channel streams are already lane shaped
+    if (channels == lanes)
+    {
+        runCascade(buffer, frames, lanes);
+        return;
+    }
+
+    for (int pos=0; pos<frames; pos += BIQUAD_BLOCK_FRAMES)
+    {
+        int n = frames - pos;
+        if (n > BIQUAD_BLOCK_FRAMES)
+            n = BIQUAD_BLOCK_FRAMES;
+
+        float *src = buffer + pos * channels;
+        std::memset(scratch, 0, sizeof(float) * n * lanes);
+        for (int i=0; i<n; i++)
+            for (int c=0; c<channels; c++)
+                scratch[i * lanes + c] = src[i * channels + c];
+
+        runCascade(scratch, n, lanes);
+
+        for (int i=0; i<n; i++)
+            for (int c=0; c<channels; c++)
+                src[i * channels + c] = scratch[i * lanes + c];
+    }
+}
+
+void BiquadEQ::process(short *buffer, int frames, int channels, float sampleRate)
+{
+    if (channels < 1 || channels > BIQUAD_MAX_CHANNELS || frames < 1)
+        return;
+
+    DenormalGuard guard;
+
+    if (!prepare(sampleRate))
+        return;
+
+    const int lanes = channels > 4 ? 8 : 4;
+
+    for (int pos=0; pos<frames; pos += BIQUAD_BLOCK_FRAMES)
+    {
+        int n = frames - pos;
+        if (n > BIQUAD_BLOCK_FRAMES)
+            n = BIQUAD_BLOCK_FRAMES;
+
+        short *src = buffer + pos * channels;
+        std::memset(scratch, 0, sizeof(float) * n * lanes);
+        for (int i=0; i<n; i++)
+            for (int c=0; c<channels; c++)
+                scratch[i * lanes + c] = src[i * channels + c] * (1.0f / 32768.0f);
+
+        runCascade(scratch, n, lanes);
+
+        for (int i=0; i<n; i++)
+        {
+            for (int c=0; c<channels; c++)
+            {
+                float v = scratch[i * lanes + c] * 32768.0f;
+                if (v > 32767.0f)
+                    v = 32767.0f;
+                else if (v < -32768.0f)
+                    v = -32768.0f;
+                src[i * channels + c] = static_cast<short>(std::lrintf(v));
+            }
+        }
+    }
+}
+
+void CALLBACK BiquadEQ::dspProc(HDSP handle, DWORD channel, void *buffer, DWORD length, void *user)
+{
+    (void)handle;
+
+    BiquadEQ *eq = static_cast<BiquadEQ*>(user);
+    if (eq == nullptr || buffer == nullptr)
+        return;
+
+    BASS_CHANNELINFO info;
+    if (!BASS_ChannelGetInfo(channel, &info) || info.chans == 0)
+        return;
+
+    if ((info.flags & BASS_SAMPLE_FLOAT) || BASS_GetConfig(BASS_CONFIG_FLOATDSP))
+    {
+        int frames = length / (sizeof(float) * info.chans);
+        eq->process(static_cast<float*>(buffer), frames, info.chans, info.freq);
+    }
+    else if (!(info.flags & BASS_SAMPLE_8BITS))
+    {
+        int frames = length / (sizeof(short) * info.chans);
+        eq->process(static_cast<short*>(buffer), frames, info.chans, info.freq);
+    }
+}
+
+void CALLBACK BiquadEQ::freeSync(HSYNC handle, DWORD channel, DWORD data, void *user)
+{
+    (void)handle;
+    (void)channel;
+    (void)data;
+
+    delete static_cast<BiquadEQ*>(user);
+}
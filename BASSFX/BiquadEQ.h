@@ -0,0 +1,68 @@
+#ifndef BIQUADEQ_H
+#define BIQUADEQ_H
+
+#include <bass.h>
+
+#include <atomic>
+#include <mutex>
+
+#define BIQUAD_MAX_BANDS    31
+#define BIQUAD_MAX_CHANNELS 8
+#define BIQUAD_BLOCK_FRAMES 256
+
+// Peaking EQ cascade (RBJ, bandwidth in octaves) used as a BASS DSP.
+// Each band is a transposed direct form II biquad, the channels of a
+// frame are processed together in SSE/AVX lanes.
+class BiquadEQ
+{
+public:
+    BiquadEQ(const float *centers, int bandCount, float bandwidth);
+    ~BiquadEQ();
+
+    int bandCount() { return nBands; }
+    float gain(int band);
+    void setGain(int band, float gain);
+
+    // clear filter state, call before attach to a new stream
+    void reset();
+
+    // interleaved float buffer, channels <= BIQUAD_MAX_CHANNELS
+    void process(float *buffer, int frames, int channels, float sampleRate);
+    void process(short *buffer, int frames, int channels, float sampleRate);
+
+    static void CALLBACK dspProc(HDSP handle, DWORD channel, void *buffer, DWORD length, void *user);
+    // BASS_SYNC_FREE, deletes the engine left on a freed stream
+    static void CALLBACK freeSync(HSYNC handle, DWORD channel, DWORD data, void *user);
+
+private:
+    void updateCoefficients(float sampleRate);
+    bool prepare(float sampleRate);
+    void runCascade(float *data, int frames, int lanes);
+
+    int nBands = 0;
+    float bw = 0.3333f;
+    float centerFreq[BIQUAD_MAX_BANDS];
+
+    // written by the GUI thread
+    std::mutex gainMutex;
+    float pendingGain[BIQUAD_MAX_BANDS];
+    std::atomic<bool> dirty;
+    std::atomic<bool> clearState;
+
+    // owned by the DSP thread
+    float rate = 0;
+    float curGain[BIQUAD_MAX_BANDS];
+    int active[BIQUAD_MAX_BANDS];
+    int activeCount = 0;
+    float b0[BIQUAD_MAX_BANDS];
+    float b1[BIQUAD_MAX_BANDS];
+    float b2[BIQUAD_MAX_BANDS];
+    float a1[BIQUAD_MAX_BANDS];
+    float a2[BIQUAD_MAX_BANDS];
+
+    float s1[BIQUAD_MAX_BANDS][BIQUAD_MAX_CHANNELS];
+    float s2[BIQUAD_MAX_BANDS][BIQUAD_MAX_CHANNELS];
+    float scratch[BIQUAD_BLOCK_FRAMES * BIQUAD_MAX_CHANNELS];
+};
+
+#endif // BIQUADEQ_H
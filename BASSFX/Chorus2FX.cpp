@@ -28,7 +28,7 @@ void Chorus2FX::on()
     fx = BASS_ChannelSetFX(stream, BASS_FX_BFX_CHORUS, priority);
 
     BASS_BFX_CHORUS cr;
-    cr.fDryMix = fDryMix;
+    cr.fDryMix = _return ? 0.0f : fDryMix;
     cr.fWetMix = fWetMix;
     cr.fFeedback = fFeedback;
     cr.fMinSweep = fMinSweep;
@@ -37,6 +37,8 @@ void Chorus2FX::on()
     cr.lChannel = BASS_BFX_CHANALL;
 
     BASS_FXSetParameters(fx, &cr);
+
+    applyReturnVolume();
 }
 
 void Chorus2FX::off()
@@ -52,6 +54,8 @@ void Chorus2FX::off()
     // ------------------------------------
 
     BASS_ChannelRemoveFX(stream, fx);
+
+    applyReturnVolume();
 }
 
 void Chorus2FX::setDryMix(float dm)
@@ -69,7 +73,7 @@ void Chorus2FX::setDryMix(float dm)
     BASS_BFX_CHORUS cr;
     if (BASS_FXGetParameters(fx, &cr))
     {
-        cr.fDryMix = fDryMix;
+        cr.fDryMix = _return ? 0.0f : fDryMix;
         BASS_FXSetParameters(fx, &cr);
     }
 }
@@ -212,6 +216,25 @@ void Chorus2FX::setStreamHandle(DWORD stream)
     else
     {
         this->stream = stream;
+        applyReturnVolume();
+    }
+}
+
+void Chorus2FX::setReturnMode(bool r)
+{
+    if (r == _return)
+        return;
+
+    if (_on)
+    {
+        off();
+        _return = r;
+        on();
+    }
+    else
+    {
+        _return = r;
+        applyReturnVolume();
     }
 }
 
@@ -232,3 +255,11 @@ void Chorus2FX::reset()
     setMaxSweep(2.0f);
     setRate(10.0f);
 }
+
+void Chorus2FX::applyReturnVolume()
+{
+    if (!_return || stream == 0)
+        return;
+
+    BASS_ChannelSetAttribute(stream, BASS_ATTRIB_VOL, _on ? 1.0f : 0.0f);
+}
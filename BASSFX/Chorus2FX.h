@@ -6,6 +6,8 @@
 class Chorus2FX : public FX
 {
 private:
+    bool _return = false;
+
     float fDryMix   = 0.9f;
     float fWetMix   = -0.2f;
     float fFeedback = 0.5f;
@@ -20,6 +22,11 @@ public:
     void on();
     void off();
 
+    // hosted on an aux return bus, the dry signal comes from the
+    // instruments so dry mix is forced to 0 and bypass mutes the bus
+    bool isReturnMode() { return _return; }
+    void setReturnMode(bool r);
+
     float dryMix() { return fDryMix; }
     float wetMix() { return fWetMix; }
     float feedback() { return fFeedback; }
@@ -39,6 +46,9 @@ public:
     void setStreamHandle(DWORD stream);
     void setBypass(bool b);
     void reset();
+
+private:
+    void applyReturnVolume();
 };
 
 #endif // CHORUSFX2_H
@@ -1,10 +1,15 @@
 #include "Equalizer15BandFX.h"
 
+static const float EQ15_FREQ[15] = { 25, 40, 63, 100, 160, 250, 400, 630, 1000,
+                                     1600, 2500, 4000, 6300, 10000, 16000 };
+
 Equalizer15BandFX::Equalizer15BandFX(DWORD stream, int priority) :FX(priority)
 {
     this->stream = stream;
     this->type = FXType::EQ15Band;
 
+    eq = new BiquadEQ(EQ15_FREQ, 15, 0.66666666666f);
+
     _on = false;
 
     fxGain[EQFrequency15Range::Frequency25Hz]    = 0;
@@ -30,6 +35,7 @@ Equalizer15BandFX::~Equalizer15BandFX()
         off();
 
     fxGain.clear();
+    delete eq;
 }
 
 void Equalizer15BandFX::on()
@@ -44,27 +50,8 @@ void Equalizer15BandFX::on()
 
     // -------------------------
 
-    fx = BASS_ChannelSetFX(stream, BASS_FX_BFX_PEAKEQ, priority);
-
-    BASS_BFX_PEAKEQ eq;
-    eq.fQ = 0;
-    eq.fBandwidth = 0.66666666666f;
-    eq.lChannel = BASS_BFX_CHANALL;
-
-    float eqfreq[15] = { 25, 40, 63, 100, 160, 250, 400, 630, 1000,
-                         1600, 2500, 4000, 6300, 10000, 16000};
-
-    int i = 0;
-    for (auto const& x : fxGain)
-    {
-        eq.lBand = i;
-        eq.fCenter = eqfreq[i];
-        eq.fGain = x.second;
-
-        BASS_FXSetParameters(fx, &eq);
-
-        i++;
-    }
+    eq->reset();
+    dsp = BASS_ChannelSetDSP(stream, &BiquadEQ::dspProc, eq, priority);
 }
 
 void Equalizer15BandFX::off()
@@ -79,9 +66,9 @@ void Equalizer15BandFX::off()
     //========================
 
 
-    BASS_ChannelRemoveFX(stream, fx);
+    BASS_ChannelRemoveDSP(stream, dsp);
 
-    fx = 0;
+    dsp = 0;
 }
 
 std::map<EQFrequency15Range, float> Equalizer15BandFX::gain()
@@ -106,16 +93,8 @@ void Equalizer15BandFX::setGain(EQFrequency15Range freq, float gain)
 
     fxGain[freq] = g;
 
-    if (!_on || stream == 0)
-        return;
-
-    BASS_BFX_PEAKEQ eq;
-    eq.lBand = static_cast<int>(freq);
-    if (BASS_FXGetParameters(fx, &eq))
-    {
-        eq.fGain = g;
-        BASS_FXSetParameters(fx, &eq);
-    }
+    // coefficients are rebuilt by the DSP thread on its next buffer
+    eq->setGain(static_cast<int>(freq), g);
 }
 
 void Equalizer15BandFX::resetGain()
@@ -169,6 +148,27 @@ void Equalizer15BandFX::setStreamHandle(DWORD stream)
     }
 }
 
+void Equalizer15BandFX::moveStreamHandle(DWORD stream)
+{
+    if (_on && this->stream != 0 && dsp != 0)
+    {
+        // the running DSP keeps its engine until the old stream is freed
+        BiquadEQ *old = eq;
+
+        eq = new BiquadEQ(EQ15_FREQ, 15, 0.66666666666f);
+        for (auto const& x : fxGain)
+            eq->setGain(static_cast<int>(x.first), x.second);
+
+        if (!BASS_ChannelSetSync(this->stream, BASS_SYNC_FREE, 0, &BiquadEQ::freeSync, old))
+            delete old;
+    }
+
+    dsp = 0;
+    this->stream = 0;
+
+    setStreamHandle(stream);
+}
+
 void Equalizer15BandFX::setBypass(bool b)
 {
     if (b)
@@ -2,6 +2,7 @@
 #define Equalizer15BandFX_H
 
 #include "FX.h"
+#include "BiquadEQ.h"
 #include <map>
 
 enum class EQFrequency15Range
@@ -26,7 +27,8 @@ enum class EQFrequency15Range
 class Equalizer15BandFX : public FX
 {
 private:
-    HFX fx = 0;
+    HDSP dsp = 0;
+    BiquadEQ *eq;
     std::map<EQFrequency15Range, float> fxGain;
 
 public:
@@ -45,6 +47,7 @@ public:
     QList<float> params();
     void setParams(const QList<float> &params);
     void setStreamHandle(DWORD stream);
+    void moveStreamHandle(DWORD stream);
     void setBypass(bool b);
     void reset();
 };
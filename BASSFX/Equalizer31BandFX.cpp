@@ -2,11 +2,17 @@
 
 #include <bass_fx.h>
 
+static const float EQ31_FREQ[31] = { 20, 25, 31.5, 40, 50, 63, 80, 100, 125, 160,
+                                     200, 250, 315, 400, 500, 630, 800, 1000, 1250, 1600,
+                                     2000, 2500, 3150, 4000, 5000, 6300, 8000, 10000, 12500, 16000, 20000 };
+
 Equalizer31BandFX::Equalizer31BandFX(DWORD stream, int priority) :FX(priority)
 {
     this->stream = stream;
     this->type = FXType::EQ31Band;
 
+    eq = new BiquadEQ(EQ31_FREQ, 31, 0.3333f);
+
     _on = false;
 
     fxGain[EQFrequency31Range::Frequency20Hz]    = 0;
@@ -48,6 +54,7 @@ Equalizer31BandFX::~Equalizer31BandFX()
         off();
 
     fxGain.clear();
+    delete eq;
 }
 
 void Equalizer31BandFX::on()
@@ -62,28 +69,8 @@ void Equalizer31BandFX::on()
 
     // -------------------------
 
-    fx = BASS_ChannelSetFX(stream, BASS_FX_BFX_PEAKEQ, priority);
-
-    BASS_BFX_PEAKEQ eq;
-    eq.fQ = 0;
-    eq.fBandwidth = 0.3333f;
-    eq.lChannel = BASS_BFX_CHANALL;
-
-    float eqfreq[31] = { 20, 25, 31.5, 40, 50, 63, 80, 100, 125, 160,
-                         200, 250, 315, 400, 500, 630, 800, 1000, 1250, 1600,
-                         2000, 2500, 3150, 4000, 5000, 6300, 8000, 10000, 12500, 16000, 20000 };
-
-    int i = 0;
-    for (auto const& x : fxGain)
-    {
-        eq.lBand = i;
-        eq.fCenter = eqfreq[i];
-        eq.fGain = x.second;
-
-        BASS_FXSetParameters(fx, &eq);
-
-        i++;
-    }
+    eq->reset();
+    dsp = BASS_ChannelSetDSP(stream, &BiquadEQ::dspProc, eq, priority);
 }
 
 void Equalizer31BandFX::off()
@@ -98,9 +85,9 @@ void Equalizer31BandFX::off()
 
     //========================
 
-    BASS_ChannelRemoveFX(stream, fx);
+    BASS_ChannelRemoveDSP(stream, dsp);
 
-    fx = 0;
+    dsp = 0;
 }
 
 std::map<EQFrequency31Range, float> Equalizer31BandFX::gain()
@@ -125,16 +112,8 @@ void Equalizer31BandFX::setGain(EQFrequency31Range freq, float gain)
 
     fxGain[freq] = g;
 
-    if (!_on || stream == 0)
-        return;
-
-    BASS_BFX_PEAKEQ eq;
-    eq.lBand = static_cast<int>(freq);
-    if (BASS_FXGetParameters(fx, &eq))
-    {
-        eq.fGain = g;
-        BASS_FXSetParameters(fx, &eq);
-    }
+    // coefficients are rebuilt by the DSP thread on its next buffer
+    eq->setGain(static_cast<int>(freq), g);
 }
 
 void Equalizer31BandFX::resetGain()
@@ -188,6 +167,27 @@ void Equalizer31BandFX::setStreamHandle(DWORD stream)
     }
 }
 
+void Equalizer31BandFX::moveStreamHandle(DWORD stream)
+{
+    if (_on && this->stream != 0 && dsp != 0)
+    {
+        // the running DSP keeps its engine until the old stream is freed
+        BiquadEQ *old = eq;
+
+        eq = new BiquadEQ(EQ31_FREQ, 31, 0.3333f);
+        for (auto const& x : fxGain)
+            eq->setGain(static_cast<int>(x.first), x.second);
+
+        if (!BASS_ChannelSetSync(this->stream, BASS_SYNC_FREE, 0, &BiquadEQ::freeSync, old))
+            delete old;
+    }
+
+    dsp = 0;
+    this->stream = 0;
+
+    setStreamHandle(stream);
+}
+
 void Equalizer31BandFX::setBypass(bool b)
 {
     if (b)
@@ -2,6 +2,7 @@
 #define EQUALIZER31BANDFX_H
 
 #include "FX.h"
+#include "BiquadEQ.h"
 
 #include <map>
 
@@ -23,7 +24,8 @@ enum class EQFrequency31Range
 class Equalizer31BandFX : public FX
 {
 private:
-    HFX fx = 0;
+    HDSP dsp = 0;
+    BiquadEQ *eq;
     std::map<EQFrequency31Range, float> fxGain;
 
 public:
@@ -42,6 +44,7 @@ public:
     QList<float> params();
     void setParams(const QList<float> &params);
     void setStreamHandle(DWORD stream);
+    void moveStreamHandle(DWORD stream);
     void setBypass(bool b);
     void reset();
 };
@@ -17,6 +17,15 @@ uint FX::uids()
     return static_cast<unsigned int>(this->type);
 }
 
+void FX::moveStreamHandle(DWORD stream)
+{
+    // forget the old effect, it is freed with its stream
+    this->fx = 0;
+    this->stream = 0;
+
+    setStreamHandle(stream);
+}
+
 
 #ifndef __linux__
 
@@ -51,6 +51,9 @@ public:
     virtual QList<float> params() = 0;
     virtual void setParams(const QList<float> &params) = 0;
     virtual void setStreamHandle(DWORD stream) = 0;
+    // attach a new instance to stream, the current one keeps running
+    // on the old stream until that stream is freed (used for crossfades)
+    virtual void moveStreamHandle(DWORD stream);
     virtual void setBypass(bool b) = 0;
     virtual void reset() = 0;
 
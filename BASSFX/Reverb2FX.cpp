@@ -28,7 +28,7 @@ void Reverb2FX::on()
     fx = BASS_ChannelSetFX(stream, BASS_FX_BFX_FREEVERB, priority);
 
     BASS_BFX_FREEVERB rv;
-    rv.fDryMix = fDryMix;
+    rv.fDryMix = _return ? 0.0f : fDryMix;
     rv.fWetMix = fWetMix;
     rv.fRoomSize = fRoomSize;
     rv.fDamp = fDamp;
@@ -36,6 +36,8 @@ void Reverb2FX::on()
     rv.lChannel = BASS_BFX_CHANALL;
 
     BASS_FXSetParameters(fx, &rv);
+
+    applyReturnVolume();
 }
 
 void Reverb2FX::off()
@@ -51,6 +53,8 @@ void Reverb2FX::off()
     // ------------------------------------
 
     BASS_ChannelRemoveFX(stream, fx);
+
+    applyReturnVolume();
 }
 
 void Reverb2FX::setDryMix(float dm)
@@ -68,7 +72,7 @@ void Reverb2FX::setDryMix(float dm)
     BASS_BFX_FREEVERB rv;
     if (BASS_FXGetParameters(fx, &rv))
     {
-        rv.fDryMix = fDryMix;
+        rv.fDryMix = _return ? 0.0f : fDryMix;
         BASS_FXSetParameters(fx, &rv);
     }
 }
@@ -187,6 +191,25 @@ void Reverb2FX::setStreamHandle(DWORD stream)
     else
     {
         this->stream = stream;
+        applyReturnVolume();
+    }
+}
+
+void Reverb2FX::setReturnMode(bool r)
+{
+    if (r == _return)
+        return;
+
+    if (_on)
+    {
+        off();
+        _return = r;
+        on();
+    }
+    else
+    {
+        _return = r;
+        applyReturnVolume();
     }
 }
 
@@ -206,3 +229,11 @@ void Reverb2FX::reset()
     setDamp(0.5f);
     setWidth(1.0f);
 }
+
+void Reverb2FX::applyReturnVolume()
+{
+    if (!_return || stream == 0)
+        return;
+
+    BASS_ChannelSetAttribute(stream, BASS_ATTRIB_VOL, _on ? 1.0f : 0.0f);
+}
@@ -6,6 +6,8 @@
 class Reverb2FX : public FX
 {
 private:
+    bool _return = false;
+
     float fDryMix   = 0.5f;
     float fWetMix   = 2.0f;
     float fRoomSize = 0.5f;
@@ -19,6 +21,11 @@ public:
     void on();
     void off();
 
+    // hosted on an aux return bus, the dry signal comes from the
+    // instruments so dry mix is forced to 0 and bypass mutes the bus
+    bool isReturnMode() { return _return; }
+    void setReturnMode(bool r);
+
     float dryMix() { return fDryMix; }
     float wetMix() { return fWetMix; }
     float roomSize() { return fRoomSize; }
@@ -36,6 +43,9 @@ public:
     void setStreamHandle(DWORD stream);
     void setBypass(bool b);
     void reset();
+
+private:
+    void applyReturnVolume();
 };
 
 #endif // REVERBFX2_H
@@ -184,6 +184,18 @@ void VSTFX::setStreamHandle(DWORD stream)
     }
 }
 
+void VSTFX::moveStreamHandle(DWORD stream)
+{
+    // keep the state, the old plugin instance is freed with its stream
+    tempChunk = chunk();
+    tempParams = params();
+    programIndex = program();
+    this->stream = 0;
+    fx = 0;
+
+    setStreamHandle(stream);
+}
+
 void VSTFX::setBypass(bool b)
 {
     _on = !b;
@@ -26,6 +26,7 @@ public:
     QList<float> params();
     void setParams(const QList<float> &params);
     void setStreamHandle(DWORD stream);
+    void moveStreamHandle(DWORD stream);
     void setBypass(bool b);
     void reset();
 
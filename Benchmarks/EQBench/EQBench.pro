@@ -0,0 +1,47 @@
+QT -= gui core
+
+CONFIG += c++11 console
+CONFIG -= app_bundle qt
+
+TARGET = EQBench
+
+# Offline benchmark, BASS_FX PEAKEQ vs native BiquadEQ
+# Build with -mavx (or /arch:AVX) to measure the 8 channel AVX path.
+
+INCLUDEPATH += $$PWD/../..
+
+SOURCES += main.cpp \
+    ../../BASSFX/BiquadEQ.cpp
+
+HEADERS += ../../BASSFX/BiquadEQ.h
+
+win32 {
+    contains(QT_ARCH, i386) {
+        LIBS += -L$$PWD/../../BASS/bass24/ -lbass
+        LIBS += -L$$PWD/../../BASS/bass_fx24/ -lbass_fx
+    } else {
+        LIBS += -L$$PWD/../../BASS/bass24/x64/ -lbass
+        LIBS += -L$$PWD/../../BASS/bass_fx24/x64/ -lbass_fx
+    }
+    INCLUDEPATH += $$PWD/../../BASS/bass24
+    INCLUDEPATH += $$PWD/../../BASS/bass_fx24
+}
+
+unix:!macx {
+    contains(QT_ARCH, i386) {
+        LIBS += -L$$PWD/../../BASS/bass24-linux/ -lbass
+        LIBS += -L$$PWD/../../BASS/bass_fx24-linux/ -lbass_fx
+    } else {
+        LIBS += -L$$PWD/../../BASS/bass24-linux/x64/ -lbass
+        LIBS += -L$$PWD/../../BASS/bass_fx24-linux/x64/ -lbass_fx
+    }
+    INCLUDEPATH += $$PWD/../../BASS/bass24-linux
+    INCLUDEPATH += $$PWD/../../BASS/bass_fx24-linux
+}
+
+macx {
+    LIBS += -L$$PWD/../../BASS/bass24-osx/ -lbass
+    LIBS += -L$$PWD/../../BASS/bass_fx24-osx/ -lbass_fx
+    INCLUDEPATH += $$PWD/../../BASS/bass24-osx
+    INCLUDEPATH += $$PWD/../../BASS/bass_fx24-osx
+}
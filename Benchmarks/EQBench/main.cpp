@@ -0,0 +1,240 @@
+#include <bass.h>
+#include <bass_fx.h>
+
+#include "BASSFX/BiquadEQ.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+// Offline comparison of BASS_FX PEAKEQ against the native BiquadEQ DSP.
+// Both run on the "no sound" device over the same decode buffers.
+
+static const int SAMPLE_RATE = 44100;
+static const int SECONDS = 20;
+static const int BLOCK_FRAMES = 441;
+
+static const float EQ31_FREQ[31] = { 20, 25, 31.5, 40, 50, 63, 80, 100, 125, 160,
+                                     200, 250, 315, 400, 500, 630, 800, 1000, 1250, 1600,
+                                     2000, 2500, 3150, 4000, 5000, 6300, 8000, 10000, 12500, 16000, 20000 };
+static const float EQ15_FREQ[15] = { 25, 40, 63, 100, 160, 250, 400, 630, 1000,
+                                     1600, 2500, 4000, 6300, 10000, 16000 };
+
+typedef struct
+{
+    const float *data;
+    DWORD bytes;
+    DWORD pos;
+} Source;
+
+typedef struct
+{
+    const char *name;
+    const float *freq;
+    int bands;
+    float bandwidth;
+    bool halfFlat;
+} EQCase;
+
+enum class Engine { None, BassFX, Native };
+
+static DWORD CALLBACK feedProc(HSTREAM handle, void *buffer, DWORD length, void *user)
+{
+    (void)handle;
+
+    Source *src = static_cast<Source*>(user);
+    DWORD n = src->bytes - src->pos;
+    if (n > length)
+        n = length;
+
+    std::memcpy(buffer, reinterpret_cast<const char*>(src->data) + src->pos, n);
+    src->pos += n;
+
+    if (src->pos >= src->bytes)
+        n |= BASS_STREAMPROC_END;
+
+    return n;
+}
+
+static float bandGain(const EQCase &c, int band)
+{
+    if (c.halfFlat && band % 2 == 1)
+        return 0;
+
+    // deterministic -12..+12 dB pattern
+    return static_cast<float>(((band * 7) % 25) - 12);
+}
+
+static double render(const EQCase &c, Engine engine, int chans, bool useFloat,
+                     const std::vector<float> &input, std::vector<float> &output)
+{
+    Source src;
+    src.data = input.data();
+    src.bytes = static_cast<DWORD>(input.size() * sizeof(float));
+    src.pos = 0;
+
+    std::vector<short> input16;
+    if (!useFloat)
+    {
+        input16.resize(input.size());
+        for (size_t i=0; i<input.size(); i++)
+            input16[i] = static_cast<short>(input[i] * 32767.0f);
+        src.data = reinterpret_cast<const float*>(input16.data());
+        src.bytes = static_cast<DWORD>(input16.size() * sizeof(short));
+    }
+
+    DWORD flags = BASS_STREAM_DECODE | (useFloat ? BASS_SAMPLE_FLOAT : 0);
+    HSTREAM stream = BASS_StreamCreate(SAMPLE_RATE, chans, flags, &feedProc, &src);
+    if (stream == 0)
+    {
+        std::cout << "BASS_StreamCreate error " << BASS_ErrorGetCode() << std::endl;
+        return -1;
+    }
+
+    BiquadEQ native(c.freq, c.bands, c.bandwidth);
+
+    if (engine == Engine::BassFX)
+    {
+        HFX fx = BASS_ChannelSetFX(stream, BASS_FX_BFX_PEAKEQ, 0);
+
+        BASS_BFX_PEAKEQ eq;
+        eq.fQ = 0;
+        eq.fBandwidth = c.bandwidth;
+        eq.lChannel = BASS_BFX_CHANALL;
+
+        for (int i=0; i<c.bands; i++)
+        {
+            eq.lBand = i;
+            eq.fCenter = c.freq[i];
+            eq.fGain = bandGain(c, i);
+            BASS_FXSetParameters(fx, &eq);
+        }
+    }
+    else if (engine == Engine::Native)
+    {
+        for (int i=0; i<c.bands; i++)
+            native.setGain(i, bandGain(c, i));
+
+        BASS_ChannelSetDSP(stream, &BiquadEQ::dspProc, &native, 0);
+    }
+
+    const int sampleBytes = useFloat ? sizeof(float) : sizeof(short);
+    const DWORD blockBytes = BLOCK_FRAMES * chans * sampleBytes;
+    std::vector<char> block(blockBytes);
+
+    output.clear();
+    output.reserve(input.size());
+
+    auto t0 = std::chrono::steady_clock::now();
+
+    for (;;)
+    {
+        DWORD got = BASS_ChannelGetData(stream, block.data(), blockBytes);
+        if (got == static_cast<DWORD>(-1) || got == 0)
+            break;
+
+        if (useFloat)
+        {
+            const float *p = reinterpret_cast<const float*>(block.data());
+            output.insert(output.end(), p, p + got / sizeof(float));
+        }
+        else
+        {
+            const short *p = reinterpret_cast<const short*>(block.data());
+            for (DWORD i=0; i<got / sizeof(short); i++)
+                output.push_back(p[i] / 32768.0f);
+        }
+    }
+
+    auto t1 = std::chrono::steady_clock::now();
+
+    BASS_StreamFree(stream);
+
+    return std::chrono::duration<double, std::nano>(t1 - t0).count();
+}
+
+int main(int argc, char *argv[])
+{
+    (void)argc;
+    (void)argv;
+
+    if (!BASS_Init(0, SAMPLE_RATE, 0, NULL, NULL))
+    {
+        std::cout << "BASS_Init error " << BASS_ErrorGetCode() << std::endl;
+        return 1;
+    }
+
+    BASS_FX_GetVersion();
+
+    const EQCase cases[] = {
+        { "31 band",           EQ31_FREQ, 31, 0.3333f,        false },
+        { "31 band, half 0dB", EQ31_FREQ, 31, 0.3333f,        true  },
+        { "15 band",           EQ15_FREQ, 15, 0.66666666666f, false }
+    };
+    const int channels[] = { 2, 8 };
+
+    std::cout << "ns / sample / channel, " << SECONDS << " s of noise at "
+              << SAMPLE_RATE << " Hz, decode overhead subtracted" << std::endl;
+    std::cout << std::left << std::setw(20) << "case" << std::setw(6) << "ch"
+              << std::setw(8) << "format" << std::right
+              << std::setw(12) << "BASS_FX" << std::setw(12) << "native"
+              << std::setw(10) << "speedup" << std::setw(14) << "max diff" << std::endl;
+
+    std::vector<float> out0, out1, out2;
+
+    for (int chans : channels)
+    {
+        // deterministic white noise at -6 dBFS
+        std::vector<float> input(static_cast<size_t>(SAMPLE_RATE) * SECONDS * chans);
+        unsigned int seed = 22222;
+        for (size_t i=0; i<input.size(); i++)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            input[i] = (static_cast<int>(seed >> 9) / 4194304.0f - 1.0f) * 0.5f;
+        }
+
+        const double samples = static_cast<double>(input.size());
+
+        for (const EQCase &c : cases)
+        {
+            for (int f=0; f<2; f++)
+            {
+                bool useFloat = f == 0;
+
+                double tNone = render(c, Engine::None, chans, useFloat, input, out0);
+                double tBass = render(c, Engine::BassFX, chans, useFloat, input, out1);
+                double tNative = render(c, Engine::Native, chans, useFloat, input, out2);
+
+                if (tNone < 0 || tBass < 0 || tNative < 0)
+                    return 2;
+
+                float maxDiff = 0;
+                size_t n = out1.size() < out2.size() ? out1.size() : out2.size();
+                for (size_t i=0; i<n; i++)
+                {
+                    float d = std::fabs(out1[i] - out2[i]);
+                    if (d > maxDiff)
+                        maxDiff = d;
+                }
+
+                double nsBass = (tBass - tNone) / samples;
+                double nsNative = (tNative - tNone) / samples;
+
+                std::cout << std::left << std::setw(20) << c.name << std::setw(6) << chans
+                          << std::setw(8) << (useFloat ? "float" : "16-bit") << std::right
+                          << std::fixed << std::setprecision(2)
+                          << std::setw(12) << nsBass << std::setw(12) << nsNative
+                          << std::setw(9) << (nsNative > 0 ? nsBass / nsNative : 0) << "x"
+                          << std::setw(14) << std::scientific << std::setprecision(2) << maxDiff
+                          << std::endl;
+            }
+        }
+    }
+
+    BASS_Free();
+
+    return 0;
+}
@@ -0,0 +1,75 @@
+QT = core
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+TARGET = FXBench
+
+# Offline benchmark of every BASSFX class
+#   FXBench [seconds] [channels]
+
+INCLUDEPATH += $$PWD/../..
+
+SOURCES += main.cpp \
+    ../../BASSFX/FX.cpp \
+    ../../BASSFX/BiquadEQ.cpp \
+    ../../BASSFX/AutoWahFX.cpp \
+    ../../BASSFX/ChorusFX.cpp \
+    ../../BASSFX/CompressorFX.cpp \
+    ../../BASSFX/DistortionFX.cpp \
+    ../../BASSFX/EchoFX.cpp \
+    ../../BASSFX/Equalizer15BandFX.cpp \
+    ../../BASSFX/Equalizer31BandFX.cpp \
+    ../../BASSFX/ReverbFX.cpp \
+    ../../BASSFX/Reverb2FX.cpp \
+    ../../BASSFX/Chorus2FX.cpp
+
+HEADERS += \
+    ../../BASSFX/FX.h \
+    ../../BASSFX/BiquadEQ.h \
+    ../../BASSFX/AutoWahFX.h \
+    ../../BASSFX/ChorusFX.h \
+    ../../BASSFX/CompressorFX.h \
+    ../../BASSFX/DistortionFX.h \
+    ../../BASSFX/EchoFX.h \
+    ../../BASSFX/Equalizer15BandFX.h \
+    ../../BASSFX/Equalizer31BandFX.h \
+    ../../BASSFX/ReverbFX.h \
+    ../../BASSFX/Reverb2FX.h \
+    ../../BASSFX/Chorus2FX.h
+
+win32 {
+    contains(QT_ARCH, i386) {
+        LIBS += -L$$PWD/../../BASS/bass24/ -lbass
+        LIBS += -L$$PWD/../../BASS/bass_fx24/ -lbass_fx
+        LIBS += -L$$PWD/../../BASS/bass_vst24/ -lbass_vst
+    } else {
+        LIBS += -L$$PWD/../../BASS/bass24/x64/ -lbass
+        LIBS += -L$$PWD/../../BASS/bass_fx24/x64/ -lbass_fx
+        LIBS += -L$$PWD/../../BASS/bass_vst24/x64/ -lbass_vst
+    }
+    INCLUDEPATH += $$PWD/../../BASS/bass24
+    INCLUDEPATH += $$PWD/../../BASS/bass_fx24
+    INCLUDEPATH += $$PWD/../../BASS/bass_vst24
+}
+
+unix:!macx {
+    contains(QT_ARCH, i386) {
+        LIBS += -L$$PWD/../../BASS/bass24-linux/ -lbass
+        LIBS += -L$$PWD/../../BASS/bass_fx24-linux/ -lbass_fx
+    } else {
+        LIBS += -L$$PWD/../../BASS/bass24-linux/x64/ -lbass
+        LIBS += -L$$PWD/../../BASS/bass_fx24-linux/x64/ -lbass_fx
+    }
+    INCLUDEPATH += $$PWD/../../BASS/bass24-linux
+    INCLUDEPATH += $$PWD/../../BASS/bass_fx24-linux
+}
+
+macx {
+    LIBS += -L$$PWD/../../BASS/bass24-osx/ -lbass
+    LIBS += -L$$PWD/../../BASS/bass_fx24-osx/ -lbass_fx
+    LIBS += -L$$PWD/../../BASS/bass_vst24-osx/ -lbass_vst
+    INCLUDEPATH += $$PWD/../../BASS/bass24-osx
+    INCLUDEPATH += $$PWD/../../BASS/bass_fx24-osx
+    INCLUDEPATH += $$PWD/../../BASS/bass_vst24-osx
+}
@@ -0,0 +1,323 @@
+#include <bass.h>
+#include <bass_fx.h>
+
+#include "BASSFX/AutoWahFX.h"
+#include "BASSFX/Chorus2FX.h"
+#include "BASSFX/ChorusFX.h"
+#include "BASSFX/CompressorFX.h"
+#include "BASSFX/DistortionFX.h"
+#include "BASSFX/EchoFX.h"
+#include "BASSFX/Equalizer15BandFX.h"
+#include "BASSFX/Equalizer31BandFX.h"
+#include "BASSFX/Reverb2FX.h"
+#include "BASSFX/ReverbFX.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+// Offline cost of every BASSFX class on the "no sound" device.
+// Each FX runs with its default (reset) params on decode streams fed
+// with deterministic content, the checksum is taken over the output
+// rounded to 16-bit so it can be compared between builds.
+//
+// usage: FXBench [seconds] [channels]
+
+static const int SAMPLE_RATE = 44100;
+static const int BLOCK_FRAMES = 441;
+static const int RUNS = 3;
+static const double PI = 3.14159265358979323846;
+
+typedef struct
+{
+    const char *data;
+    DWORD bytes;
+    DWORD pos;
+} Source;
+
+typedef struct
+{
+    const char *name;
+    FX* (*create)(DWORD stream);
+} FXCase;
+
+typedef struct
+{
+    const char *name;
+    std::vector<float> samples;
+} Signal;
+
+typedef struct
+{
+    double ns;
+    unsigned int checksum;
+} Result;
+
+static FX *createNone(DWORD stream)
+{
+    (void)stream;
+    return nullptr;
+}
+
+template <class T>
+static FX *createFX(DWORD stream)
+{
+    T *fx = new T(stream, 0);
+    fx->setBypass(false);
+    fx->reset();
+    return fx;
+}
+
+static FX *createEQ15(DWORD stream)
+{
+    Equalizer15BandFX *fx = new Equalizer15BandFX(stream, 0);
+    fx->setBypass(false);
+    for (int i=0; i<15; i++)
+        fx->setGain(static_cast<EQFrequency15Range>(i), static_cast<float>(((i * 7) % 25) - 12));
+    return fx;
+}
+
+static FX *createEQ31(DWORD stream)
+{
+    Equalizer31BandFX *fx = new Equalizer31BandFX(stream, 0);
+    fx->setBypass(false);
+    for (int i=0; i<31; i++)
+        fx->setGain(static_cast<EQFrequency31Range>(i), static_cast<float>(((i * 7) % 25) - 12));
+    return fx;
+}
+
+static DWORD CALLBACK feedProc(HSTREAM handle, void *buffer, DWORD length, void *user)
+{
+    (void)handle;
+
+    Source *src = static_cast<Source*>(user);
+    DWORD n = src->bytes - src->pos;
+    if (n > length)
+        n = length;
+
+    std::memcpy(buffer, src->data + src->pos, n);
+    src->pos += n;
+
+    if (src->pos >= src->bytes)
+        n |= BASS_STREAMPROC_END;
+
+    return n;
+}
+
+static void makeSignals(std::vector<Signal> &signals, int seconds, int chans)
+{
+    size_t frames = static_cast<size_t>(SAMPLE_RATE) * seconds;
+
+    Signal noise;
+    noise.name = "noise";
+    noise.samples.resize(frames * chans);
+    unsigned int seed = 22222;
+    for (size_t i=0; i<noise.samples.size(); i++)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        noise.samples[i] = (static_cast<int>(seed >> 9) / 4194304.0f - 1.0f) * 0.5f;
+    }
+    signals.push_back(noise);
+
+    // 220 Hz with a 3 kHz partial, channels slightly detuned
+    Signal sine;
+    sine.name = "sine";
+    sine.samples.resize(frames * chans);
+    for (size_t f=0; f<frames; f++)
+    {
+        for (int c=0; c<chans; c++)
+        {
+            double t = static_cast<double>(f) / SAMPLE_RATE;
+            double v = 0.4 * std::sin(2 * PI * (220.0 + c) * t) + 0.1 * std::sin(2 * PI * 3000.0 * t);
+            sine.samples[f * chans + c] = static_cast<float>(v);
+        }
+    }
+    signals.push_back(sine);
+
+    // a full scale click every 500 ms, silence between (denormal tails)
+    Signal impulse;
+    impulse.name = "impulse";
+    impulse.samples.assign(frames * chans, 0.0f);
+    for (size_t f=0; f<frames; f+=SAMPLE_RATE/2)
+    {
+        for (int c=0; c<chans; c++)
+            impulse.samples[f * chans + c] = 0.9f;
+    }
+    signals.push_back(impulse);
+}
+
+static Result render(const FXCase &c, const Signal &signal, int chans, bool useFloat)
+{
+    Result result = { -1, 0 };
+
+    std::vector<short> input16;
+    Source src;
+    src.data = reinterpret_cast<const char*>(signal.samples.data());
+    src.bytes = static_cast<DWORD>(signal.samples.size() * sizeof(float));
+    src.pos = 0;
+
+    if (!useFloat)
+    {
+        input16.resize(signal.samples.size());
+        for (size_t i=0; i<input16.size(); i++)
+            input16[i] = static_cast<short>(signal.samples[i] * 32767.0f);
+        src.data = reinterpret_cast<const char*>(input16.data());
+        src.bytes = static_cast<DWORD>(input16.size() * sizeof(short));
+    }
+
+    DWORD flags = BASS_STREAM_DECODE | (useFloat ? BASS_SAMPLE_FLOAT : 0);
+    HSTREAM stream = BASS_StreamCreate(SAMPLE_RATE, chans, flags, &feedProc, &src);
+    if (stream == 0)
+    {
+        std::cout << "BASS_StreamCreate error " << BASS_ErrorGetCode() << std::endl;
+        return result;
+    }
+
+    FX *fx = c.create(stream);
+
+    const int sampleBytes = useFloat ? sizeof(float) : sizeof(short);
+    const DWORD blockBytes = BLOCK_FRAMES * chans * sampleBytes;
+    std::vector<char> block(blockBytes);
+
+    // FNV-1a over the output as 16-bit
+    unsigned int hash = 2166136261u;
+
+    double ns = 0;
+
+    for (;;)
+    {
+        auto t0 = std::chrono::steady_clock::now();
+        DWORD got = BASS_ChannelGetData(stream, block.data(), blockBytes);
+        auto t1 = std::chrono::steady_clock::now();
+
+        if (got == static_cast<DWORD>(-1) || got == 0)
+            break;
+
+        ns += std::chrono::duration<double, std::nano>(t1 - t0).count();
+
+        DWORD count = got / sampleBytes;
+        for (DWORD i=0; i<count; i++)
+        {
+            int v;
+            if (useFloat)
+            {
+                float f = reinterpret_cast<const float*>(block.data())[i] * 32768.0f;
+                if (f > 32767.0f)
+                    f = 32767.0f;
+                else if (f < -32768.0f)
+                    f = -32768.0f;
+                v = static_cast<int>(std::lrint(f));
+            }
+            else
+            {
+                v = reinterpret_cast<const short*>(block.data())[i];
+            }
+
+            hash = (hash ^ (v & 0xFF)) * 16777619u;
+            hash = (hash ^ ((v >> 8) & 0xFF)) * 16777619u;
+        }
+    }
+
+    delete fx;
+    BASS_StreamFree(stream);
+
+    result.ns = ns;
+    result.checksum = hash;
+
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    int seconds = argc > 1 ? std::atoi(argv[1]) : 10;
+    int chans = argc > 2 ? std::atoi(argv[2]) : 2;
+
+    if (seconds <= 0)
+        seconds = 10;
+    if (chans <= 0 || chans > 8)
+        chans = 2;
+
+    if (!BASS_Init(0, SAMPLE_RATE, 0, NULL, NULL))
+    {
+        std::cout << "BASS_Init error " << BASS_ErrorGetCode() << std::endl;
+        return 1;
+    }
+
+    BASS_FX_GetVersion();
+
+    const FXCase cases[] = {
+        { "(none)",            &createNone },
+        { "AutoWahFX",         &createFX<AutoWahFX> },
+        { "ChorusFX",          &createFX<ChorusFX> },
+        { "CompressorFX",      &createFX<CompressorFX> },
+        { "DistortionFX",      &createFX<DistortionFX> },
+        { "EchoFX",            &createFX<EchoFX> },
+        { "Equalizer15BandFX", &createEQ15 },
+        { "Equalizer31BandFX", &createEQ31 },
+        { "ReverbFX",          &createFX<ReverbFX> },
+        { "Reverb2FX",         &createFX<Reverb2FX> },
+        { "Chorus2FX",         &createFX<Chorus2FX> }
+    };
+
+    std::vector<Signal> signals;
+    makeSignals(signals, seconds, chans);
+
+    std::cout << seconds << " s at " << SAMPLE_RATE << " Hz, " << chans
+              << " channels, FX cost excludes the (none) decode time" << std::endl;
+    std::cout << std::left << std::setw(20) << "fx" << std::setw(9) << "signal"
+              << std::setw(8) << "format" << std::right
+              << std::setw(14) << "Msamples/s" << std::setw(14) << "realtime x"
+              << std::setw(12) << "checksum" << std::endl;
+
+    for (int f=0; f<2; f++)
+    {
+        bool useFloat = f == 0;
+
+        for (const Signal &signal : signals)
+        {
+            const double samples = static_cast<double>(signal.samples.size());
+            double base = 0;
+
+            for (const FXCase &c : cases)
+            {
+                // best of RUNS, the checksum must not change between them
+                Result r = render(c, signal, chans, useFloat);
+                for (int run=1; run<RUNS && r.ns >= 0; run++)
+                {
+                    Result next = render(c, signal, chans, useFloat);
+                    if (next.checksum != r.checksum)
+                        std::cout << c.name << ": output differs between runs" << std::endl;
+                    if (next.ns >= 0 && next.ns < r.ns)
+                        r.ns = next.ns;
+                }
+
+                if (r.ns < 0)
+                    return 2;
+
+                double ns = r.ns;
+                if (c.create == &createNone)
+                    base = ns;
+                else
+                    ns = ns > base ? ns - base : 0;
+
+                double msps = ns > 0 ? samples / ns * 1000.0 : 0;
+                double rt = ns > 0 ? seconds * 1e9 / ns : 0;
+
+                std::cout << std::left << std::setw(20) << c.name << std::setw(9) << signal.name
+                          << std::setw(8) << (useFloat ? "float" : "16-bit") << std::right
+                          << std::fixed << std::setprecision(1)
+                          << std::setw(14) << msps << std::setw(14) << std::setprecision(0) << rt
+                          << "  " << std::hex << std::setw(8) << std::setfill('0') << r.checksum
+                          << std::dec << std::setfill(' ') << std::endl;
+            }
+        }
+    }
+
+    BASS_Free();
+
+    return 0;
+}
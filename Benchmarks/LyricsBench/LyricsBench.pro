@@ -0,0 +1,28 @@
+QT += core gui widgets
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+TARGET = LyricsBench
+
+# Offscreen replay of LyricsWidget at 60 fps, 720p, 1080p and 4K
+#   LyricsBench [song dir] [songs]
+
+INCLUDEPATH += $$PWD/../.. \
+    $$PWD/../../Widgets
+
+SOURCES += main.cpp \
+    ../../Widgets/LyricsWidget.cpp \
+    ../../Widgets/LyricsRenderer.cpp \
+    ../../NCNDecoder.cpp \
+    ../../CompanionResolver.cpp \
+    ../../Midi/MidiFile.cpp \
+    ../../Midi/MidiEvent.cpp
+
+HEADERS += \
+    ../../Widgets/LyricsWidget.h \
+    ../../Widgets/LyricsRenderer.h \
+    ../../NCNDecoder.h \
+    ../../CompanionResolver.h \
+    ../../Midi/MidiFile.h \
+    ../../Midi/MidiEvent.h
@@ -0,0 +1,297 @@
+#include "LyricsWidget.h"
+#include "LyricsRenderer.h"
+#include "CompanionResolver.h"
+#include "NCNDecoder.h"
+#include "Midi/MidiFile.h"
+
+#include <QApplication>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QImage>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+// Cost of the lyrics on the screen. Every song is replayed through
+// LyricsWidget at 60 fps under the offscreen platform, each frame
+// moves the clock and paints the whole widget into an image. A frame
+// over the 60 fps budget is a dropped frame. The drawn lines still come
+// back from the render thread between the frames, but the replay does not
+// wait for the real time, so the lines drawn ahead are a worst case.
+// Without a song folder a deterministic set is generated.
+//
+// usage: LyricsBench [song dir] [songs]
+//   the dir is an NCN folder (Song, Cursor, Lyrics) or a folder of .kar
+
+static const int FPS = 60;
+static const int GENERATED_SONGS = 10;
+static const int GENERATED_RESOLUTION = 96;
+
+typedef struct
+{
+    QString lyrics;
+    QVector<long> cursors;
+    QVector<long> times;
+} BenchSong;
+
+typedef struct
+{
+    const char *name;
+    int width;
+    int height;
+} BenchScreen;
+
+static const BenchScreen SCREENS[] = {
+    { "720p", 1280, 720 },
+    { "1080p", 1920, 1080 },
+    { "4K", 3840, 2160 }
+};
+
+typedef struct
+{
+    std::vector<qint64> frameNs;
+    std::vector<qint64> switchNs;
+    int dropped;
+    qint64 peakBytes;
+} BenchResult;
+
+static QVector<long> cursorTimes(MidiFile *midi, const QVector<long> &cursors)
+{
+    QVector<long> times;
+    times.reserve(cursors.count());
+    for (long tick : cursors)
+        times.append(static_cast<long>(midi->timeFromTick(qMax(0L, tick)) * 1000));
+    return times;
+}
+
+static bool loadNCN(const QString &midPath, BenchSong *song)
+{
+    QFile cur(CompanionResolver::curFilePath(midPath));
+    QFile lyr(CompanionResolver::lyrFilePath(midPath));
+    if (!cur.open(QFile::ReadOnly) || !lyr.open(QFile::ReadOnly))
+        return false;
+
+    MidiFile midi;
+    if (!midi.read(midPath))
+        return false;
+
+    song->lyrics = NCNDecoder::lyrText(lyr.readAll());
+    song->cursors = NCNDecoder::cursorTicks(cur.readAll(), midi.resorution());
+    song->times = cursorTimes(&midi, song->cursors);
+
+    return !song->cursors.isEmpty();
+}
+
+static bool loadKAR(const QString &path, BenchSong *song)
+{
+    MidiFile midi;
+    if (!midi.read(path))
+        return false;
+
+    song->lyrics = midi.lyrics();
+    song->cursors = midi.lyricsCursor();
+    song->times = cursorTimes(&midi, song->cursors);
+
+    return !song->cursors.isEmpty();
+}
+
+static void loadTree(const QString &dir, int max, std::vector<BenchSong> &songs)
+{
+    QDirIterator it(dir, QStringList() << "*.mid" << "*.MID" << "*.kar" << "*.KAR",
+                    QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext() && static_cast<int>(songs.size()) < max)
+    {
+        QString path = it.next();
+
+        BenchSong song;
+        bool ok = path.endsWith(".kar", Qt::CaseInsensitive) ? loadKAR(path, &song) : loadNCN(path, &song);
+        if (ok)
+            songs.push_back(song);
+    }
+}
+
+static void generate(std::vector<BenchSong> &songs)
+{
+    unsigned int seed = 22222;
+    auto next = [&seed]() { seed = seed * 1664525u + 1013904223u; return seed >> 8; };
+
+    for (int s=0; s<GENERATED_SONGS; s++)
+    {
+        // 40 thai lines at 120 bpm, a cursor for each character and line
+        BenchSong song;
+        QStringList lines;
+        long tick = GENERATED_RESOLUTION * 4;
+
+        for (int l=0; l<40; l++)
+        {
+            QString line;
+            int n = 12 + next() % 24;
+            for (int c=0; c<n; c++)
+                line += next() % 6 == 0 ? QChar(' ') : QChar(0x0E01 + next() % 0x2E);
+
+            // the line start, then the characters
+            for (int c=0; c<=n; c++)
+            {
+                song.cursors.append(tick);
+                tick += GENERATED_RESOLUTION / 8 + next() % GENERATED_RESOLUTION;
+            }
+            tick += GENERATED_RESOLUTION * (next() % 4);
+
+            lines << line;
+        }
+
+        song.lyrics = lines.join("\r\n");
+        for (long t : song.cursors)
+            song.times.append(t * 1000 / (GENERATED_RESOLUTION * 2));
+
+        songs.push_back(song);
+    }
+}
+
+static BenchResult replay(const BenchScreen &screen, const std::vector<BenchSong> &songs)
+{
+    BenchResult r;
+    r.dropped = 0;
+    r.peakBytes = 0;
+
+    const qint64 budgetNs = 1000000000ll / FPS;
+
+    // the font and the lines follow the screen height, like the settings of a venue
+    LyricsWidget w;
+    w.setAttribute(Qt::WA_DontShowOnScreen);
+    w.resize(screen.width, screen.height);
+
+    QFont f = w.textFont();
+    f.setPointSize(screen.height / 15);
+    w.setTextFont(f);
+    w.setLine1Y(screen.height * 320 / 1080);
+    w.setLine2Y(screen.height * 170 / 1080);
+    w.show();
+
+    QImage frame(w.size(), QImage::Format_ARGB32_Premultiplied);
+
+    for (const BenchSong &song : songs)
+    {
+        w.setLyrics(song.lyrics, song.cursors, song.times);
+        QCoreApplication::processEvents();
+
+        QString line1 = w.textLine1();
+        QString line2 = w.textLine2();
+        long end = song.times.last() + 1000;
+
+        for (qint64 i=0; ; i++)
+        {
+            long ms = static_cast<long>(i * 1000 / FPS);
+            if (ms > end)
+                break;
+
+            QElapsedTimer t;
+            t.start();
+
+            w.setPositionMs(ms);
+            frame.fill(Qt::transparent);
+            w.render(&frame);
+
+            qint64 ns = t.nsecsElapsed();
+            r.frameNs.push_back(ns);
+            if (ns > budgetNs)
+                r.dropped++;
+
+            if (w.textLine1() != line1 || w.textLine2() != line2)
+            {
+                r.switchNs.push_back(ns);
+                line1 = w.textLine1();
+                line2 = w.textLine2();
+            }
+
+            // the drawn lines come back from the render thread
+            QCoreApplication::processEvents();
+
+            r.peakBytes = qMax(r.peakBytes, w.cacheBytes() + LyricsRenderer::sharedBytes());
+        }
+    }
+
+    return r;
+}
+
+static double meanUs(const std::vector<qint64> &ns)
+{
+    if (ns.empty())
+        return 0;
+
+    double total = 0;
+    for (qint64 v : ns)
+        total += v;
+    return total / ns.size() / 1000.0;
+}
+
+static double percentileUs(std::vector<qint64> ns, double p)
+{
+    if (ns.empty())
+        return 0;
+
+    std::sort(ns.begin(), ns.end());
+    size_t i = std::min(ns.size() - 1, static_cast<size_t>(ns.size() * p));
+    return ns[i] / 1000.0;
+}
+
+static void print(const BenchScreen &screen, const BenchResult &r)
+{
+    std::cout << std::left << std::setw(8) << screen.name << std::right
+              << std::fixed << std::setprecision(1)
+              << std::setw(9) << r.frameNs.size()
+              << std::setw(11) << meanUs(r.frameNs)
+              << std::setw(11) << percentileUs(r.frameNs, 0.99)
+              << std::setw(11) << percentileUs(r.frameNs, 1.0)
+              << std::setw(9) << r.switchNs.size()
+              << std::setw(11) << meanUs(r.switchNs)
+              << std::setw(11) << percentileUs(r.switchNs, 1.0)
+              << std::setw(9) << r.dropped
+              << std::setw(10) << r.peakBytes / (1024.0 * 1024.0) << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    QApplication app(argc, argv);
+
+    qRegisterMetaType<LineJob>("LineJob");
+    qRegisterMetaType<LineImages>("LineImages");
+
+    QString dir = argc > 1 ? QString::fromLocal8Bit(argv[1]) : QString();
+    int max = argc > 2 ? std::atoi(argv[2]) : 50;
+    if (max <= 0)
+        max = 50;
+
+    std::vector<BenchSong> songs;
+    if (!dir.isEmpty())
+        loadTree(dir, max, songs);
+
+    if (songs.empty())
+    {
+        generate(songs);
+        std::cout << "generated: ";
+    }
+    else
+    {
+        std::cout << dir.toStdString() << ": ";
+    }
+
+    std::cout << songs.size() << " songs, " << FPS << " fps, full frame paints" << std::endl;
+    std::cout << std::left << std::setw(8) << "screen" << std::right
+              << std::setw(9) << "frames" << std::setw(11) << "mean us" << std::setw(11) << "p99 us"
+              << std::setw(11) << "max us" << std::setw(9) << "switch" << std::setw(11) << "mean us"
+              << std::setw(11) << "max us" << std::setw(9) << "dropped" << std::setw(10) << "peak MB"
+              << std::endl;
+
+    for (const BenchScreen &screen : SCREENS)
+        print(screen, replay(screen, songs));
+
+    return 0;
+}
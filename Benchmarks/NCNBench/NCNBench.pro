@@ -0,0 +1,16 @@
+QT = core
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+TARGET = NCNBench
+
+# Offline benchmark of the .cur and .lyr decoders, Qt streams vs NCNDecoder
+#   NCNBench [ncn dir] [runs]
+
+INCLUDEPATH += $$PWD/../..
+
+SOURCES += main.cpp \
+    ../../NCNDecoder.cpp
+
+HEADERS += ../../NCNDecoder.h
@@ -0,0 +1,232 @@
+#include "NCNDecoder.h"
+
+#include <QByteArray>
+#include <QDataStream>
+#include <QDirIterator>
+#include <QFile>
+#include <QList>
+#include <QTextStream>
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+// Decode cost of the NCN cursor and lyrics files at song start and in
+// the indexer. The files are read into memory first, only the decoding
+// is timed. Without an NCN folder a deterministic set is generated.
+//
+// usage: NCNBench [ncn dir] [runs]
+
+static const int RESOLUTION = 96;
+static const int GENERATED_SONGS = 2000;
+
+typedef struct
+{
+    std::vector<QByteArray> curs;
+    std::vector<QByteArray> lyrs;
+    qint64 curBytes;
+    qint64 lyrBytes;
+} SampleSet;
+
+typedef struct
+{
+    double ns;
+    quint64 checksum;
+} Result;
+
+static quint64 mix(quint64 hash, quint64 v)
+{
+    return (hash ^ v) * 1099511628211ull;
+}
+
+static void loadTree(const QString &dir, const QStringList &filters, std::vector<QByteArray> &files, qint64 *bytes)
+{
+    QDirIterator it(dir, filters, QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext())
+    {
+        QFile f(it.next());
+        if (!f.open(QFile::ReadOnly))
+            continue;
+
+        files.push_back(f.readAll());
+        *bytes += files.back().size();
+    }
+}
+
+static void generate(SampleSet &set)
+{
+    unsigned int seed = 22222;
+    auto next = [&seed]() { seed = seed * 1664525u + 1013904223u; return seed >> 8; };
+
+    for (int s=0; s<GENERATED_SONGS; s++)
+    {
+        // a lyric of 40 lines, thai with some ascii, a cursor per character
+        QByteArray lyr;
+        lyr += "Song " + QByteArray::number(s) + "\r\n";
+        lyr += "Artist\r\nC\r\n\r\n";
+        for (int l=0; l<40; l++)
+        {
+            int n = 12 + next() % 24;
+            for (int c=0; c<n; c++)
+                lyr += static_cast<char>(next() % 4 == 0 ? 'a' + next() % 26 : 0xA1 + next() % 0x3A);
+            lyr += "\r\n";
+        }
+
+        QByteArray cur;
+        int pos = 0;
+        for (int c=0; c<lyr.size(); c++)
+        {
+            pos += next() % 12;
+            cur += static_cast<char>(pos & 0xFF);
+            cur += static_cast<char>((pos >> 8) & 0xFF);
+        }
+
+        set.lyrs.push_back(lyr);
+        set.curs.push_back(cur);
+        set.lyrBytes += lyr.size();
+        set.curBytes += cur.size();
+    }
+}
+
+static QList<long> streamCursor(const QByteArray &data)
+{
+    QList<long> curs;
+    QDataStream in(data);
+    while (!in.atEnd())
+    {
+        quint8 b1 = 0;
+        quint8 b2 = 0;
+        in >> b1;
+        in >> b2;
+        curs.append((b1 + (b2 << 8)) * RESOLUTION / 24);
+    }
+    return curs;
+}
+
+static QString streamLyrics(const QByteArray &data)
+{
+    QTextStream in(data);
+    in.setCodec("TIS-620");
+    in.readLine();
+    in.readLine();
+    in.readLine();
+    in.readLine();
+    return in.readAll();
+}
+
+template <class F>
+static Result timeRun(F decode)
+{
+    Result r = { 0, 14695981039346656037ull };
+
+    auto t0 = std::chrono::steady_clock::now();
+    r.checksum = decode();
+    auto t1 = std::chrono::steady_clock::now();
+
+    r.ns = std::chrono::duration<double, std::nano>(t1 - t0).count();
+    return r;
+}
+
+template <class F>
+static Result best(F decode, int runs)
+{
+    Result r = timeRun(decode);
+    for (int i=1; i<runs; i++)
+    {
+        Result next = timeRun(decode);
+        if (next.checksum != r.checksum)
+            std::cout << "output differs between runs" << std::endl;
+        if (next.ns < r.ns)
+            r.ns = next.ns;
+    }
+    return r;
+}
+
+static void print(const char *name, const Result &r, qint64 bytes, size_t files)
+{
+    double mbps = r.ns > 0 ? bytes / r.ns * 1000.0 : 0;
+    double usPerFile = files > 0 ? r.ns / files / 1000.0 : 0;
+
+    std::cout << std::left << std::setw(22) << name << std::right
+              << std::fixed << std::setprecision(1)
+              << std::setw(12) << mbps << std::setw(12) << std::setprecision(2) << usPerFile
+              << "  " << std::hex << std::setw(16) << std::setfill('0') << r.checksum
+              << std::dec << std::setfill(' ') << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    QString dir = argc > 1 ? QString::fromLocal8Bit(argv[1]) : QString();
+    int runs = argc > 2 ? std::atoi(argv[2]) : 5;
+    if (runs <= 0)
+        runs = 5;
+
+    SampleSet set;
+    set.curBytes = 0;
+    set.lyrBytes = 0;
+
+    if (!dir.isEmpty())
+    {
+        loadTree(dir + "/Cursor", QStringList() << "*.cur" << "*.CUR", set.curs, &set.curBytes);
+        loadTree(dir + "/Lyrics", QStringList() << "*.lyr" << "*.LYR", set.lyrs, &set.lyrBytes);
+        std::cout << dir.toStdString() << ": ";
+    }
+    else
+    {
+        generate(set);
+        std::cout << "generated: ";
+    }
+
+    std::cout << set.curs.size() << " cur (" << set.curBytes / 1024 << " KB), "
+              << set.lyrs.size() << " lyr (" << set.lyrBytes / 1024 << " KB), best of "
+              << runs << std::endl;
+    std::cout << std::left << std::setw(22) << "decoder" << std::right
+              << std::setw(12) << "MB/s" << std::setw(12) << "us/file"
+              << std::setw(18) << "checksum" << std::endl;
+
+    // the same checksum means the same ticks and the same text
+    Result curStream = best([&set]() {
+        quint64 h = 14695981039346656037ull;
+        for (const QByteArray &cur : set.curs)
+            for (long t : streamCursor(cur))
+                h = mix(h, static_cast<quint64>(t));
+        return h;
+    }, runs);
+
+    Result curDirect = best([&set]() {
+        quint64 h = 14695981039346656037ull;
+        for (const QByteArray &cur : set.curs)
+            for (long t : NCNDecoder::cursorTicks(cur, RESOLUTION))
+                h = mix(h, static_cast<quint64>(t));
+        return h;
+    }, runs);
+
+    Result lyrStream = best([&set]() {
+        quint64 h = 14695981039346656037ull;
+        for (const QByteArray &lyr : set.lyrs)
+            for (QChar c : streamLyrics(lyr))
+                h = mix(h, c.unicode());
+        return h;
+    }, runs);
+
+    Result lyrDirect = best([&set]() {
+        quint64 h = 14695981039346656037ull;
+        for (const QByteArray &lyr : set.lyrs)
+            for (QChar c : NCNDecoder::lyrText(lyr))
+                h = mix(h, c.unicode());
+        return h;
+    }, runs);
+
+    print("cur QDataStream", curStream, set.curBytes, set.curs.size());
+    print("cur NCNDecoder", curDirect, set.curBytes, set.curs.size());
+    print("lyr QTextStream", lyrStream, set.lyrBytes, set.lyrs.size());
+    print("lyr NCNDecoder", lyrDirect, set.lyrBytes, set.lyrs.size());
+
+    bool same = curStream.checksum == curDirect.checksum && lyrStream.checksum == lyrDirect.checksum;
+    if (!same)
+        std::cout << "decoders disagree" << std::endl;
+
+    return same ? 0 : 1;
+}
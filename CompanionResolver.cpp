@@ -0,0 +1,96 @@
+#include "CompanionResolver.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QHash>
+
+#include <mutex>
+
+
+namespace {
+
+typedef struct
+{
+    QHash<QString, QString> files;  // case folded name -> name on the disk
+    qint64 listedAt;
+} Listing;
+
+std::mutex listingMutex;
+QHash<QString, Listing> listings;
+
+// a name that is not there lists the directory again, but not more often than this
+const qint64 RELIST_MS = 2000;
+
+Listing listDirectory(const QString &dir)
+{
+    Listing l;
+    l.listedAt = QDateTime::currentMSecsSinceEpoch();
+
+    // sorted, 123.CUR wins over 123.cur like the old probe order
+    for (const QString &name : QDir(dir).entryList(QDir::Files, QDir::Name))
+    {
+        QString key = name.toCaseFolded();
+        if (!l.files.contains(key))
+            l.files.insert(key, name);
+    }
+
+    return l;
+}
+
+} // namespace
+
+QString CompanionResolver::curFilePath(const QString &midFilePath)
+{
+    return resolve(midFilePath, "Cursor", "cur");
+}
+
+QString CompanionResolver::lyrFilePath(const QString &midFilePath)
+{
+    return resolve(midFilePath, "Lyrics", "lyr");
+}
+
+void CompanionResolver::invalidate(const QString &dir)
+{
+    std::lock_guard<std::mutex> lock(listingMutex);
+
+    if (dir.isEmpty())
+        listings.clear();
+    else
+        listings.remove(QDir::cleanPath(dir));
+}
+
+QString CompanionResolver::resolve(const QString &midFilePath, const QString &tree, const QString &suffix)
+{
+    int song = midFilePath.lastIndexOf("/Song/");
+    int slash = midFilePath.lastIndexOf("/");
+    if (song < 0)
+        return "";
+
+    // the same subdirectory in the other tree
+    QString dir = QDir::cleanPath(midFilePath.left(song) + "/" + tree + midFilePath.mid(song + 5, slash - song - 5));
+
+    QString base = midFilePath.mid(slash + 1);
+    int dot = base.lastIndexOf(".");
+    if (dot >= 0)
+        base.truncate(dot);
+
+    QString key = (base + "." + suffix).toCaseFolded();
+
+    std::lock_guard<std::mutex> lock(listingMutex);
+
+    QHash<QString, Listing>::iterator it = listings.find(dir);
+    if (it == listings.end())
+        it = listings.insert(dir, listDirectory(dir));
+
+    QHash<QString, QString>::const_iterator f = it->files.constFind(key);
+    if (f == it->files.constEnd() && QDateTime::currentMSecsSinceEpoch() - it->listedAt > RELIST_MS)
+    {
+        *it = listDirectory(dir);
+        f = it->files.constFind(key);
+    }
+
+    if (f == it->files.constEnd())
+        return "";
+
+    return dir + "/" + f.value();
+}
@@ -0,0 +1,24 @@
+#ifndef COMPANIONRESOLVER_H
+#define COMPANIONRESOLVER_H
+
+#include <QString>
+
+// The .cur and .lyr of an NCN mid, Song/x/123.MID has Cursor/x/123.cur
+// and Lyrics/x/123.LYR in any case. Each directory is listed once into
+// a case folded map, a name is a hash lookup. Shared by the index
+// workers and the main thread.
+class CompanionResolver
+{
+public:
+    // "" when there is none
+    static QString curFilePath(const QString &midFilePath);
+    static QString lyrFilePath(const QString &midFilePath);
+
+    // files were added or deleted in dir, an empty dir forgets every listing
+    static void invalidate(const QString &dir = QString());
+
+private:
+    static QString resolve(const QString &midFilePath, const QString &tree, const QString &suffix);
+};
+
+#endif // COMPANIONRESOLVER_H
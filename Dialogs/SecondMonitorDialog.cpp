@@ -27,7 +27,7 @@ SecondMonitorDialog::SecondMonitorDialog(QWidget *parent, LyricsWidget *lyr) :
     ui->lyr->setAnimationTime(lyr->animationTime());
     ui->lyr->setAutoFontSize(lyr->isAutoFontSize());
 
-    ui->lyr->setLyrics(lyr->lyrData(), lyr->curData());
+    ui->lyr->setLyrics(lyr->lyrData(), lyr->curData(), lyr->curTimes());
 
     ui->lyr->hide();
 }
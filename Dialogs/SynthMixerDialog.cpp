@@ -37,7 +37,9 @@ SynthMixerDialog::SynthMixerDialog(QWidget *parent, MainWindow *mainWin) : //, M
     QDialog(parent),
     ui(new Ui::SynthMixerDialog),
     signalVstActionMapper(this),
-    signalBusActionMapper(this)
+    signalBusActionMapper(this),
+    signalReverbSendMapper(this),
+    signalChorusSendMapper(this)
 {
     ui->setupUi(this);
 
@@ -110,6 +112,9 @@ SynthMixerDialog::SynthMixerDialog(QWidget *parent, MainWindow *mainWin) : //, M
             }
         }
 
+        // Aux send/return -----------------------------
+        synth->setUseAuxBus(st.value("AuxBus", false).toBool());
+
         // Master Eq -----------------------------------
         {
             bool eqOn = st.value("MasterEqOn", false).toBool();
@@ -168,6 +173,8 @@ SynthMixerDialog::SynthMixerDialog(QWidget *parent, MainWindow *mainWin) : //, M
             bool s = st.value("Solo", false).toBool();
             int  v = st.value("VSTi", -1).toInt();
             int sp = st.value("Speaker", 0).toInt();
+            int rs = st.value("ReverbSend", 100).toInt();
+            int cs = st.value("ChorusSend", 100).toInt();
 
             InstCh * ich = chInstMap[t];
             ich->setSliderLevel(ml);
@@ -192,6 +199,8 @@ SynthMixerDialog::SynthMixerDialog(QWidget *parent, MainWindow *mainWin) : //, M
             synth->setSolo(t, s);
             synth->setUseVSTi(t, v);
             synth->setSpeaker(t, static_cast<SpeakerType>(sp));
+            synth->setReverbSend(t, rs);
+            synth->setChorusSend(t, cs);
 
             #ifdef __linux__
             if (t >= InstrumentType::VSTi1 && t <= InstrumentType::VSTi4)
@@ -204,6 +213,8 @@ SynthMixerDialog::SynthMixerDialog(QWidget *parent, MainWindow *mainWin) : //, M
     connect(&btnPresets, SIGNAL(buttonClicked(int)), this, SLOT(changeSoundfontPresets(int)));
     connect(&signalVstActionMapper, SIGNAL(mapped(QString)), this, SLOT(addFX(QString)));
     connect(&signalBusActionMapper, SIGNAL(mapped(int)), this, SLOT(setBusGroup(int)));
+    connect(&signalReverbSendMapper, SIGNAL(mapped(int)), this, SLOT(setReverbSend(int)));
+    connect(&signalChorusSendMapper, SIGNAL(mapped(int)), this, SLOT(setChorusSend(int)));
 }
 
 SynthMixerDialog::~SynthMixerDialog()
@@ -320,6 +331,9 @@ void SynthMixerDialog::settingValues()
     // soundfont presets
     st.setValue("SoundfontPresets", synth->soundfontPresets());
 
+    // Aux send/return
+    st.setValue("AuxBus", synth->isUseAuxBus());
+
     // Master Eq
     auto eq = synth->equalizer31BandFXs()[0];
     st.setValue("MasterEqOn", eq->isOn());
@@ -383,6 +397,8 @@ void SynthMixerDialog::settingValues()
         st.setValue("Solo", synth->isSolo(t));
         st.setValue("Bus", synth->busGroup(t));
         st.setValue("VSTi", synth->useVSTi(t));
+        st.setValue("ReverbSend", synth->reverbSend(t));
+        st.setValue("ChorusSend", synth->chorusSend(t));
 
         QVariant v = QVariant::fromValue(synth->fxUids(t));
         st.setValue("VstUid", v);
@@ -703,6 +719,24 @@ void SynthMixerDialog::createBusActions(InstrumentType t, QMenu *busMenu)
     }
 }
 
+void SynthMixerDialog::createSendActions(InstrumentType t, QMenu *sendMenu, bool reverb)
+{
+    int level = reverb ? synth->reverbSend(t) : synth->chorusSend(t);
+    QSignalMapper *mapper = reverb ? &signalReverbSendMapper : &signalChorusSendMapper;
+
+    sendMenu->setEnabled(synth->isUseAuxBus());
+
+    for (int i=0; i<=100; i += 25) {
+        QAction *act = sendMenu->addAction(QString::number(i) + " %");
+        connect(act, SIGNAL(triggered()), mapper, SLOT(map()));
+        mapper->setMapping(act, i);
+        if (level == i) {
+            act->setCheckable(true);
+            act->setChecked(true);
+        }
+    }
+}
+
 void SynthMixerDialog::showChannelMenu(InstrumentType type, const QPoint &pos)
 {
     currentType = type;
@@ -743,6 +777,12 @@ void SynthMixerDialog::showChannelMenu(InstrumentType type, const QPoint &pos)
         menu.addSeparator();
         QMenu *busMenu = menu.addMenu("Bus Group");
         createBusActions(type, busMenu);
+
+        menu.addSeparator();
+        QMenu *reverbMenu = menu.addMenu("Reverb Send");
+        createSendActions(type, reverbMenu, true);
+        QMenu *chorusMenu = menu.addMenu("Chorus Send");
+        createSendActions(type, chorusMenu, false);
     }
 
     connect(signalBFXActionMapper, SIGNAL(mapped(QString)), this, SLOT(addFX(QString)));
@@ -755,6 +795,16 @@ void SynthMixerDialog::setBusGroup(int group)
     synth->setBusGroup(currentType, group);
 }
 
+void SynthMixerDialog::setReverbSend(int level)
+{
+    synth->setReverbSend(currentType, level);
+}
+
+void SynthMixerDialog::setChorusSend(int level)
+{
+    synth->setChorusSend(currentType, level);
+}
+
 FX* SynthMixerDialog::addFX(const QString &uidStr, bool bypass)
 {
     uint uid = uidStr.toUInt();
@@ -916,6 +966,7 @@ void SynthMixerDialog::on_btnMenu_clicked()
     QAction eqAct(eqOn ? onIcon : offIcon, tr("อีควอไลเซอร์..."), this);
     QAction chrAct(chrOn ? onIcon : offIcon, tr("เอฟเฟ็กต์เสียงประสาน..."), this);
     QAction revAct(revOn ? onIcon : offIcon, tr("เอฟเฟ็กต์เสียงก้อง..."), this);
+    QAction auxAct(tr("ใช้เสียงก้อง/ประสานแบบ Aux Send"), this);
     QAction resetAct(QIcon(":Icons/refresh.png"), tr("รีเซ็ต"), this);
     QAction parentAct(tr("แยกหน้าต่างจากหน้าต่างหลัก"), this);
     QAction stayTopAct(tr("อยู่บนสุดตลอดเวลา"), this);
@@ -925,6 +976,9 @@ void SynthMixerDialog::on_btnMenu_clicked()
         parentAct.setChecked(true);
     }
 
+    auxAct.setCheckable(true);
+    auxAct.setChecked(synth->isUseAuxBus());
+
     stayTopAct.setCheckable(true);
     stayTopAct.setChecked(staysOnTop);
     stayTopAct.setEnabled(parent() == 0);
@@ -938,6 +992,7 @@ void SynthMixerDialog::on_btnMenu_clicked()
     connect(&eqAct, SIGNAL(triggered()), this, SLOT(showEqDialog()));
     connect(&chrAct, SIGNAL(triggered()), this, SLOT(showChorusDialog()));
     connect(&revAct, SIGNAL(triggered()), this, SLOT(showReverbDialog()));
+    connect(&auxAct, SIGNAL(triggered(bool)), this, SLOT(setUseAuxBus(bool)));
     connect(&resetAct, SIGNAL(triggered()), this, SLOT(resetChannel()));
     connect(&parentAct, SIGNAL(triggered()), this, SLOT(toggleWindowParent()));
     connect(&stayTopAct, SIGNAL(triggered(bool)), this, SLOT(setStaysOnTop(bool)));
@@ -954,6 +1009,7 @@ void SynthMixerDialog::on_btnMenu_clicked()
     menu.addAction(&eqAct);
     menu.addAction(&chrAct);
     menu.addAction(&revAct);
+    menu.addAction(&auxAct);
     menu.addSeparator();
     menu.addAction(&resetAct);
     menu.addSeparator();
@@ -1034,6 +1090,11 @@ void SynthMixerDialog::toggleWindowParent()
     this->show();
 }
 
+void SynthMixerDialog::setUseAuxBus(bool use)
+{
+    synth->setUseAuxBus(use);
+}
+
 void SynthMixerDialog::setStaysOnTop(bool stay)
 {
     this->close();
@@ -51,6 +51,8 @@ private slots:
 
     void showChannelMenu(InstrumentType type, const QPoint &pos);
     void setBusGroup(int group);
+    void setReverbSend(int level);
+    void setChorusSend(int level);
     FX* addFX(const QString &uidStr, bool bypass = false);
     void byPassFX(InstrumentType type, int fxIndex, bool bypass);
     void showFxDialog(InstrumentType type, int fxIndex);
@@ -66,6 +68,7 @@ private slots:
     void resetChannel();
     void toggleWindowParent();
     void setStaysOnTop(bool stay);
+    void setUseAuxBus(bool use);
 
     void changeSoundfontPresets(int presets);
 
@@ -87,6 +90,8 @@ private:
     QList<QMenu*> vstVendorMenus;
     QSignalMapper signalVstActionMapper;
     QSignalMapper signalBusActionMapper;
+    QSignalMapper signalReverbSendMapper;
+    QSignalMapper signalChorusSendMapper;
     QSignalMapper *signalBFXActionMapper = nullptr;
 
     QButtonGroup btnPresets;
@@ -98,6 +103,7 @@ private:
     void mapChInstUI();
     void setChInstDetails();
     void createBusActions(InstrumentType t, QMenu *busMenu);
+    void createSendActions(InstrumentType t, QMenu *sendMenu, bool reverb);
 };
 
 #endif // SYNTHMIXERDIALOG_H
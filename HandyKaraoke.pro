@@ -17,14 +17,22 @@ SOURCES += main.cpp\
         MainWindow.cpp \
     SettingsDialog.cpp \
     SongDatabase.cpp \
+    LibraryIndexer.cpp \
+    LibraryWatcher.cpp \
+    CompanionResolver.cpp \
+    NCNDecoder.cpp \
+    SearchWorker.cpp \
+    PrefixIndex.cpp \
     Song.cpp \
     Midi/MidiFile.cpp \
     Midi/MidiEvent.cpp \
     Midi/MidiOut.cpp \
     Midi/Channel.cpp \
     Midi/MidiSynthesizer.cpp \
+    Midi/ParallelRenderer.cpp \
     Widgets/ChMx.cpp \
     Widgets/LyricsWidget.cpp \
+    Widgets/LyricsRenderer.cpp \
     Widgets/RhythmWidget.cpp \
     Widgets/ChannelMixer.cpp \
     Midi/MidiHelper.cpp \
@@ -56,6 +64,7 @@ SOURCES += main.cpp\
     Dialogs/SecondMonitorDialog.cpp \
     Midi/MidiSequencer.cpp \
     Midi/MidiPlayer.cpp \
+    Midi/MidiAnalyzer.cpp \
     Dialogs/MapChannelDialog.cpp \
     Widgets/ChMxComboBox.cpp \
     BASSFX/AutoWahFX.cpp \
@@ -76,20 +85,29 @@ SOURCES += main.cpp\
     Dialogs/Chorus2Dialog.cpp \
     BASSFX/Chorus2FX.cpp \
     BASSFX/Reverb2FX.cpp \
+    BASSFX/BiquadEQ.cpp \
     Dialogs/Reverb2Dialog.cpp \
     Dialogs/DeleteSongDialog.cpp
 
 HEADERS  += MainWindow.h \
     SettingsDialog.h \
     SongDatabase.h \
+    LibraryIndexer.h \
+    LibraryWatcher.h \
+    CompanionResolver.h \
+    NCNDecoder.h \
+    SearchWorker.h \
+    PrefixIndex.h \
     Song.h \
     Midi/MidiFile.h \
     Midi/MidiEvent.h \
     Midi/MidiOut.h \
     Midi/Channel.h \
     Midi/MidiSynthesizer.h \
+    Midi/ParallelRenderer.h \
     Widgets/ChMx.h \
     Widgets/LyricsWidget.h \
+    Widgets/LyricsRenderer.h \
     Widgets/RhythmWidget.h \
     Widgets/ChannelMixer.h \
     Midi/MidiHelper.h \
@@ -122,6 +140,7 @@ HEADERS  += MainWindow.h \
     Dialogs/SecondMonitorDialog.h \
     Midi/MidiSequencer.h \
     Midi/MidiPlayer.h \
+    Midi/MidiAnalyzer.h \
     DrumPadsKey.h \
     version.h \
     Dialogs/MapChannelDialog.h \
@@ -145,6 +164,7 @@ HEADERS  += MainWindow.h \
     Dialogs/Chorus2Dialog.h \
     BASSFX/Chorus2FX.h \
     BASSFX/Reverb2FX.h \
+    BASSFX/BiquadEQ.h \
     Dialogs/Reverb2Dialog.h \
     Midi/HNKFileComp.h \
     Dialogs/DeleteSongDialog.h
@@ -0,0 +1,312 @@
+#include "LibraryIndexer.h"
+
+#include "CompanionResolver.h"
+#include "SongDatabase.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+
+#include <chrono>
+
+
+LibraryIndexer::LibraryIndexer()
+{
+    found = 0;
+    probed = 0;
+    cancel = false;
+}
+
+LibraryIndexer::~LibraryIndexer()
+{
+    stop();
+}
+
+void LibraryIndexer::addRoot(const QString &type, const QString &root, const QString &dir, const QStringList &filters)
+{
+    if (root.isEmpty())
+        return;
+
+    Root r;
+    r.type = type;
+    r.root = root;
+    r.dir = dir;
+    r.filters = filters;
+
+    roots.append(r);
+}
+
+void LibraryIndexer::addFile(const LibraryFile &f)
+{
+    listed.append(f);
+}
+
+void LibraryIndexer::start(const QHash<QString, FileStamp> &indexed, int workers)
+{
+    stop();
+
+    this->indexed = indexed;
+
+    walkDone = false;
+    cancel = false;
+    found = 0;
+    probed = 0;
+
+    if (workers < 1)
+        workers = 1;
+
+    liveWorkers = workers;
+
+    walker = std::thread(&LibraryIndexer::walk, this);
+    for (int i=0; i<workers; i++)
+        this->workers.push_back(std::thread(&LibraryIndexer::work, this));
+}
+
+void LibraryIndexer::stop()
+{
+    cancel = true;
+
+    {
+        std::lock_guard<std::mutex> lock(jobMutex);
+        jobCond.notify_all();
+    }
+    {
+        std::lock_guard<std::mutex> lock(resultMutex);
+        spaceCond.notify_all();
+        resultCond.notify_all();
+    }
+
+    if (walker.joinable())
+        walker.join();
+
+    for (std::thread &t : workers)
+        t.join();
+    workers.clear();
+
+    jobs.clear();
+    results.clear();
+    liveWorkers = 0;
+}
+
+bool LibraryIndexer::takeResult(IndexResult *r, int timeoutMs)
+{
+    std::unique_lock<std::mutex> lock(resultMutex);
+
+    resultCond.wait_for(lock, std::chrono::milliseconds(timeoutMs),
+                        [this] { return !results.empty() || liveWorkers == 0; });
+
+    if (results.empty())
+        return false;
+
+    *r = results.front();
+    results.pop_front();
+
+    lock.unlock();
+    spaceCond.notify_one();
+
+    return true;
+}
+
+bool LibraryIndexer::isFinished()
+{
+    std::lock_guard<std::mutex> lock(resultMutex);
+    return liveWorkers == 0 && results.empty();
+}
+
+QHash<QString, FileStamp> LibraryIndexer::vanishedFiles()
+{
+    if (walker.joinable())
+        walker.join();
+
+    // a cancelled walk did not see every file
+    if (cancel)
+        return QHash<QString, FileStamp>();
+
+    return indexed;
+}
+
+void LibraryIndexer::walk()
+{
+    for (const LibraryFile &f : listed)
+    {
+        if (cancel)
+            break;
+        push(f);
+    }
+
+    // a tree at a time, the workers start on its first files
+    for (const Root &root : roots)
+    {
+        QDirIterator it(root.dir, root.filters, QDir::Files, QDirIterator::Subdirectories);
+        while (it.hasNext() && !cancel)
+        {
+            it.next();
+
+            LibraryFile f;
+            f.type = root.type;
+            f.root = root.root;
+            f.filePath = it.filePath();
+            f.fileName = it.fileName();
+
+            push(f);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(jobMutex);
+    walkDone = true;
+    jobCond.notify_all();
+}
+
+void LibraryIndexer::push(const LibraryFile &f)
+{
+    Job job;
+    job.file = f;
+
+    QHash<QString, FileStamp>::iterator i = indexed.find(fileKey(f.type, relativePath(f)));
+    job.known = i != indexed.end();
+    if (job.known)
+    {
+        job.old = i.value();
+        indexed.erase(i);
+    }
+
+    found++;
+
+    std::lock_guard<std::mutex> lock(jobMutex);
+    jobs.push_back(job);
+    jobCond.notify_one();
+}
+
+void LibraryIndexer::work()
+{
+    for (;;)
+    {
+        Job job;
+
+        {
+            std::unique_lock<std::mutex> lock(jobMutex);
+            jobCond.wait(lock, [this] { return !jobs.empty() || walkDone || cancel; });
+
+            if (cancel || jobs.empty())
+                break;
+
+            job = jobs.front();
+            jobs.pop_front();
+        }
+
+        IndexResult r;
+        bool write = probe(job, &r);
+        probed++;
+
+        if (!write)
+            continue;
+
+        std::unique_lock<std::mutex> lock(resultMutex);
+        spaceCond.wait(lock, [this] { return results.size() < MAX_RESULTS || cancel; });
+
+        if (cancel)
+            break;
+
+        results.push_back(r);
+        resultCond.notify_one();
+    }
+
+    std::lock_guard<std::mutex> lock(resultMutex);
+    liveWorkers--;
+    resultCond.notify_all();
+}
+
+bool LibraryIndexer::probe(const Job &job, IndexResult *r)
+{
+    r->file = job.file;
+    r->path = relativePath(job.file);
+    r->stamp = fileStamp(job.file);
+    r->replace = job.known;
+    r->ok = false;
+
+    if (job.known)
+    {
+        if (job.old.size == r->stamp.size && job.old.mtime == r->stamp.mtime)
+            return false;
+
+        // touched but the same content
+        r->stamp.hash = fileHash(job.file);
+        if (r->stamp.hash == job.old.hash)
+        {
+            r->action = IndexAction::Touched;
+            return true;
+        }
+    }
+    else
+    {
+        r->stamp.hash = fileHash(job.file);
+    }
+
+    // failed files are written too, so they are not parsed again until they change
+    r->action = IndexAction::Parsed;
+    r->ok = parseFile(job.file, &r->song);
+
+    return true;
+}
+
+QString LibraryIndexer::relativePath(const LibraryFile &f)
+{
+    // same as the insert functions store in songs.path
+    QString path = f.filePath;
+    return path.replace(f.root, "");
+}
+
+FileStamp LibraryIndexer::fileStamp(const LibraryFile &f)
+{
+    QStringList paths;
+    paths << f.filePath;
+    if (f.type == "NCN")
+        paths << CompanionResolver::curFilePath(f.filePath) << CompanionResolver::lyrFilePath(f.filePath);
+
+    FileStamp stamp = { 0, 0, "" };
+
+    for (const QString &p : paths)
+    {
+        if (p.isEmpty())
+            continue;
+
+        QFileInfo info(p);
+        stamp.size += info.size();
+        stamp.mtime = qMax(stamp.mtime, info.lastModified().toMSecsSinceEpoch());
+    }
+
+    return stamp;
+}
+
+QString LibraryIndexer::fileHash(const LibraryFile &f)
+{
+    QStringList paths;
+    paths << f.filePath;
+    if (f.type == "NCN")
+        paths << CompanionResolver::curFilePath(f.filePath) << CompanionResolver::lyrFilePath(f.filePath);
+
+    QCryptographicHash hash(QCryptographicHash::Md5);
+
+    for (const QString &p : paths)
+    {
+        QFile file(p);
+        if (!p.isEmpty() && file.open(QFile::ReadOnly))
+            hash.addData(&file);
+    }
+
+    return QString(hash.result().toHex());
+}
+
+bool LibraryIndexer::parseFile(const LibraryFile &f, SongRecord *song)
+{
+    QString id = f.fileName.section(".", 0, 0);
+
+    if (f.type == "NCN")
+        return SongDatabase::parseNCN(f.root, id, f.filePath, song);
+    else if (f.type == "HNK")
+        return SongDatabase::parseHNK(f.root, id, f.filePath, song);
+    else
+        return SongDatabase::parseKAR(f.root, "-------", f.filePath, f.fileName, song);
+}
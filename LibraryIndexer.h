@@ -0,0 +1,144 @@
+#ifndef LIBRARYINDEXER_H
+#define LIBRARYINDEXER_H
+
+#include "Midi/MidiAnalyzer.h"
+
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// a song file found by the library scan
+typedef struct
+{
+    QString type;       // NCN, HNK, KAR
+    QString root;
+    QString filePath;
+    QString fileName;
+} LibraryFile;
+
+// what a file looked like when it was indexed,
+// NCN covers the mid with its cur and lyr
+typedef struct
+{
+    qint64 size;
+    qint64 mtime;
+    QString hash;
+} FileStamp;
+
+// a row of the songs table
+typedef struct
+{
+    QString id;
+    QString name;
+    QString artist;
+    QString key;
+    int tempo;
+    QString type;
+    QString lyrics;
+    QString path;
+    SongAnalysis info;  // not valid when the midi could not be read
+} SongRecord;
+
+enum class IndexAction {
+    Parsed,     // new or changed, song is valid when ok
+    Touched     // same content, only the stamp is saved
+};
+
+typedef struct
+{
+    IndexAction action;
+    LibraryFile file;
+    QString path;       // relative to the root, as in songs.path
+    FileStamp stamp;
+    bool replace;       // songs of the path are already in the database
+    bool ok;
+    SongRecord song;
+} IndexResult;
+
+// Walker thread -> probe/parse workers -> results for one writer.
+// The walker takes the found files out of the indexed map, what is
+// left after finished() is gone from the disk.
+class LibraryIndexer
+{
+public:
+    LibraryIndexer();
+    ~LibraryIndexer();
+
+    void addRoot(const QString &type, const QString &root, const QString &dir, const QStringList &filters);
+    // a known list instead of walking the roots
+    void addFile(const LibraryFile &f);
+
+    void start(const QHash<QString, FileStamp> &indexed, int workers);
+    void stop();
+
+    // false when nothing came in timeoutMs or everything is done
+    bool takeResult(IndexResult *r, int timeoutMs);
+    bool isFinished();
+
+    int foundCount() { return found; }
+    int probedCount() { return probed; }
+    QHash<QString, FileStamp> vanishedFiles();
+
+    static QString fileKey(const QString &type, const QString &path) { return type + ":" + path; }
+    static QString relativePath(const LibraryFile &f);
+    static FileStamp fileStamp(const LibraryFile &f);
+    static QString fileHash(const LibraryFile &f);
+    static bool parseFile(const LibraryFile &f, SongRecord *song);
+
+private:
+    typedef struct
+    {
+        LibraryFile file;
+        bool known;
+        FileStamp old;
+    } Job;
+
+    typedef struct
+    {
+        QString type;
+        QString root;
+        QString dir;
+        QStringList filters;
+    } Root;
+
+    void walk();
+    void push(const LibraryFile &f);
+    void work();
+    bool probe(const Job &job, IndexResult *r);
+
+    QList<Root> roots;
+    QList<LibraryFile> listed;
+    QHash<QString, FileStamp> indexed;
+
+    std::mutex jobMutex;
+    std::condition_variable jobCond;
+    std::deque<Job> jobs;
+    bool walkDone = false;
+
+    // bounded, the workers wait for the writer
+    std::mutex resultMutex;
+    std::condition_variable resultCond;
+    std::condition_variable spaceCond;
+    std::deque<IndexResult> results;
+    int liveWorkers = 0;
+
+    std::atomic<bool> cancel;
+
+    std::atomic<int> found;
+    std::atomic<int> probed;
+
+    std::thread walker;
+    std::vector<std::thread> workers;
+
+    const size_t MAX_RESULTS = 1024;
+};
+
+#endif // LIBRARYINDEXER_H
@@ -0,0 +1,137 @@
+#include "LibraryWatcher.h"
+
+#include <QDir>
+#include <QDirIterator>
+#include <QFileSystemWatcher>
+
+
+LibraryWatcher::LibraryWatcher(QObject *parent) : QObject(parent)
+{
+    quietTimer.setSingleShot(true);
+
+    connect(&quietTimer, SIGNAL(timeout()), this, SLOT(flush()));
+}
+
+void LibraryWatcher::setRoots(const QStringList &roots)
+{
+    QStringList dirs;
+    for (const QString &root : roots)
+    {
+        QString dir = QDir::cleanPath(root);
+        if (!dir.isEmpty() && QDir(dir).exists() && !dirs.contains(dir))
+            dirs << dir;
+    }
+
+    if (watcher != nullptr && dirs == this->roots)
+        return;
+
+    clear();
+
+    // a new watcher, removing thousands of paths one by one is slow
+    watcher = new QFileSystemWatcher(this);
+    connect(watcher, SIGNAL(directoryChanged(QString)), this, SLOT(onDirectoryChanged(QString)));
+
+    this->roots = dirs;
+    for (const QString &dir : dirs)
+        watchTree(dir, nullptr);
+}
+
+void LibraryWatcher::clear()
+{
+    quietTimer.stop();
+    dirty.clear();
+    watched.clear();
+    roots.clear();
+
+    delete watcher;
+    watcher = nullptr;
+}
+
+void LibraryWatcher::markChanged(const QStringList &dirs)
+{
+    for (const QString &dir : dirs)
+        onDirectoryChanged(dir);
+}
+
+void LibraryWatcher::onDirectoryChanged(const QString &dir)
+{
+    if (dirty.isEmpty())
+        firstChange.start();
+
+    dirty.insert(QDir::cleanPath(dir));
+
+    // wait for a quiet time, but not longer than the max delay from the first change
+    int left = MAX_DELAY_MS - static_cast<int>(firstChange.elapsed());
+    quietTimer.start(qMax(0, qMin(QUIET_MS, left)));
+}
+
+void LibraryWatcher::flush()
+{
+    if (dirty.isEmpty() || watcher == nullptr)
+        return;
+
+    QStringList dirs;
+
+    for (const QString &dir : dirty)
+    {
+        dirs << dir;
+
+        if (!QDir(dir).exists())
+        {
+            unwatchTree(dir);
+            continue;
+        }
+
+        // a copied folder is new, its files are in no other event
+        QDirIterator it(dir, QDir::Dirs | QDir::NoDotAndDotDot);
+        while (it.hasNext())
+        {
+            QString sub = QDir::cleanPath(it.next());
+            if (!watched.contains(sub))
+                watchTree(sub, &dirs);
+        }
+    }
+
+    dirty.clear();
+
+    emit directoriesChanged(dirs);
+}
+
+void LibraryWatcher::watchTree(const QString &dir, QStringList *added)
+{
+    QStringList dirs;
+    dirs << dir;
+
+    QDirIterator it(dir, QDir::Dirs | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+    while (it.hasNext())
+        dirs << QDir::cleanPath(it.next());
+
+    QStringList fresh;
+    for (const QString &d : dirs)
+    {
+        if (watched.contains(d))
+            continue;
+
+        watched.insert(d);
+        fresh << d;
+    }
+
+    if (added != nullptr)
+        added->append(fresh);
+
+    if (!fresh.isEmpty())
+        watcher->addPaths(fresh);
+}
+
+void LibraryWatcher::unwatchTree(const QString &dir)
+{
+    // the watcher drops a deleted directory by itself
+    QString below = dir + "/";
+    for (QSet<QString>::iterator it = watched.begin(); it != watched.end(); )
+    {
+        if (*it == dir || it->startsWith(below))
+            it = watched.erase(it);
+        else
+            ++it;
+    }
+}
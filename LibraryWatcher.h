@@ -0,0 +1,56 @@
+#ifndef LIBRARYWATCHER_H
+#define LIBRARYWATCHER_H
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QSet>
+#include <QStringList>
+#include <QTimer>
+
+class QFileSystemWatcher;
+
+// Watches the song folders (inotify on linux). A copy of a song pack
+// changes a directory many times, the changes are collected until the
+// folders are quiet and reported once. New subdirectories are watched
+// and reported with their parent.
+class LibraryWatcher : public QObject
+{
+    Q_OBJECT
+public:
+    LibraryWatcher(QObject *parent = nullptr);
+
+    // every directory below the roots is watched
+    void setRoots(const QStringList &roots);
+    void clear();
+
+    int watchedCount() { return watched.count(); }
+
+public slots:
+    // look at these again after the next quiet time
+    void markChanged(const QStringList &dirs);
+
+signals:
+    void directoriesChanged(const QStringList &dirs);
+
+private slots:
+    void onDirectoryChanged(const QString &dir);
+    void flush();
+
+private:
+    void watchTree(const QString &dir, QStringList *added);
+    void unwatchTree(const QString &dir);
+
+    QFileSystemWatcher *watcher = nullptr;
+    QStringList roots;
+    QSet<QString> watched;
+    QSet<QString> dirty;
+
+    QTimer quietTimer;
+    QElapsedTimer firstChange;
+
+    const int QUIET_MS = 1500;
+    // a long copy still updates the library from time to time
+    const int MAX_DELAY_MS = 10000;
+};
+
+#endif // LIBRARYWATCHER_H
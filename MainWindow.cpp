@@ -9,9 +9,12 @@
 #include <QDirIterator>
 #include <QFileDialog>
 #include <QWindow>
+#include <QScreen>
+#include <QGuiApplication>
 
 #include "Config.h"
 #include "Utils.h"
+#include "CompanionResolver.h"
 #include "DrumPadsKey.h"
 #include "SettingsDialog.h"
 #include "Midi/MidiFile.h"
@@ -96,17 +99,19 @@ MainWindow::MainWindow(QWidget *parent) :
     db->setNcnPath(ncn);
     db->setHNKPath(hnk);
     db->setKarPath(kar);
+    db->setWatchEnabled(settings->value("WatchLibrary", true).toBool());
 
 
     timer1 = new QTimer();
     timer2 = new QTimer();
     timer2->setSingleShot(true);
 
-    positionTimer = new QTimer(this);
-    positionTimer->setInterval(30);
-
-    lyricsTimer = new QTimer(0);
-    lyricsTimer->setInterval(30);
+    // one clock for the lyrics, the position and the rhythm, once a frame
+    frameTimer = new QTimer(this);
+    frameTimer->setTimerType(Qt::PreciseTimer);
+    QScreen *screen = QGuiApplication::primaryScreen();
+    qreal rate = screen != nullptr && screen->refreshRate() > 0 ? screen->refreshRate() : 60;
+    frameTimer->setInterval(qMax(1, qRound(1000 / rate)));
 
     detailTimer = new QTimer();
     detailTimer->setSingleShot(true);
@@ -230,6 +235,11 @@ MainWindow::MainWindow(QWidget *parent) :
         bool useFX = settings->value("SynthUseFXRC", false).toBool();
         synth->setUsetFloattingPoint(useFloat);
         synth->setUseFXRC(useFX);
+        synth->setUseParallelRender(settings->value("SynthParallelRender", true).toBool());
+
+        // voices and interpolation follow the cpu load
+        synth->setCpuCeiling(settings->value("SynthCpuCeiling", 75).toInt());
+        synth->setUseGovernor(settings->value("SynthGovernor", true).toBool());
 
         // Soundfonts and Soundfonts map
         // move to setup in main function (main.cpp)
@@ -350,15 +360,15 @@ MainWindow::MainWindow(QWidget *parent) :
         }
         #endif
 
-        connect(db, SIGNAL(started()), updateDetail, SLOT(show()));
+        connect(db, SIGNAL(started()), this, SLOT(onDbUpdateStarted()));
         connect(db, SIGNAL(finished()), updateDetail, SLOT(hide()));
         connect(db, SIGNAL(updatePositionChanged(int)), this, SLOT(onDbUpdateChanged(int)));
+        connect(db, SIGNAL(searchFinished(Song*)), this, SLOT(setFrameSearch(Song*)));
 
         connect(timer1, SIGNAL(timeout()), this, SLOT(showCurrentTime()));
         connect(timer2, SIGNAL(timeout()), this, SLOT(hideUIFrame()));
 
-        connect(positionTimer, SIGNAL(timeout()), this, SLOT(onPositiomTimerTimeOut()));
-        connect(lyricsTimer, SIGNAL(timeout()), this, SLOT(onLyricsTimerTimeOut()));
+        connect(frameTimer, SIGNAL(timeout()), this, SLOT(onFrameTimerTimeOut()));
 
         connect(detailTimer, SIGNAL(timeout()), this, SLOT(onDetailTimerTimeout()));
 
@@ -435,8 +445,7 @@ MainWindow::~MainWindow()
 
     delete detailTimer;
 
-    delete lyricsTimer;
-    delete positionTimer;
+    delete frameTimer;
     delete timer2;
     delete timer1;
 
@@ -504,8 +513,7 @@ void MainWindow::play(int index, int position)
             player->setPositionTick(position);
 
         player->play();
-        positionTimer->start();
-        lyricsTimer->start();
+        frameTimer->start();
         return;
     }
 
@@ -532,7 +540,7 @@ void MainWindow::play(int index, int position)
             return;
         }
 
-        QString curPath = db->getCurFilePath(p);
+        QString curPath = CompanionResolver::curFilePath(p);
         if (curPath == "" || !QFile::exists(curPath)) {
             QMessageBox::warning(this, tr("ไม่สามารถเล่นเพลงได้"),
                                  tr("ไม่มีไฟล์ Cursor รหัส ") + playingSong.id() +
@@ -540,7 +548,7 @@ void MainWindow::play(int index, int position)
             return;
         }
 
-        QString lyrPath = db->getLyrFilePath(p);
+        QString lyrPath = CompanionResolver::lyrFilePath(p);
         if (lyrPath == "" || !QFile::exists(lyrPath)) {
             QMessageBox::warning(this, tr("ไม่สามารถเล่นเพลงได้"),
                                  tr("ไม่มีไฟล์ Lyrics รหัส ") + playingSong.id() +
@@ -548,8 +556,8 @@ void MainWindow::play(int index, int position)
             return;
         }
 
-        lyrWidget->setLyrics(Utils::readLyrics(lyrPath),
-            Utils::readCurFile(curPath, player->midiFile()->resorution()));
+        QVector<long> curs = Utils::readCurFile(curPath, player->midiFile()->resorution());
+        lyrWidget->setLyrics(Utils::readLyrics(lyrPath), curs, cursorTimes(curs));
 
     }
     else if (playingSong.songType() == "HNK")
@@ -579,8 +587,8 @@ void MainWindow::play(int index, int position)
 
         mid.remove();
 
-        lyrWidget->setLyrics(Utils::readLyrics(HNKFile::lyrData(p)),
-            Utils::readCurFile(HNKFile::curData(p), player->midiFile()->resorution()));
+        QVector<long> curs = Utils::readCurFile(HNKFile::curData(p), player->midiFile()->resorution());
+        lyrWidget->setLyrics(Utils::readLyrics(HNKFile::lyrData(p)), curs, cursorTimes(curs));
 
     }
     else if (playingSong.songType() == "KAR")
@@ -599,7 +607,8 @@ void MainWindow::play(int index, int position)
             return;
         }
 
-        lyrWidget->setLyrics(player->midiFile()->lyrics(), player->midiFile()->lyricsCursor());
+        QVector<long> curs = player->midiFile()->lyricsCursor();
+        lyrWidget->setLyrics(player->midiFile()->lyrics(), curs, cursorTimes(curs));
     }
     else
     {
@@ -607,7 +616,7 @@ void MainWindow::play(int index, int position)
     }
 
     if (secondLyr != nullptr)
-        secondLyr->setLyrics(lyrWidget->lyrData(), lyrWidget->curData());
+        secondLyr->setLyrics(lyrWidget->lyrData(), lyrWidget->curData(), lyrWidget->curTimes());
 
     onPlayerDurationTickChanged(player->durationTick());
     onPlayerDurationMSChanged(player->durationMs());
@@ -641,17 +650,12 @@ void MainWindow::play(int index, int position)
 
     if (secondLyr != nullptr)
         secondLyr->show();
-    positionTimer->start();
-    lyricsTimer->start();
+    frameTimer->start();
 }
 
 void MainWindow::pause()
 {
-    positionTimer->stop();
-    lyricsTimer->stop();
-    lyrWidget->stopAnimation();
-    if (secondLyr != nullptr)
-        secondLyr->stopAnimation();
+    frameTimer->stop();
     player->stop();
 
     #ifdef _WIN32
@@ -662,8 +666,7 @@ void MainWindow::pause()
 void MainWindow::resume()
 {
     player->play();
-    positionTimer->start();
-    lyricsTimer->start();
+    frameTimer->start();
 
     #ifdef _WIN32
     taskbarButton->progress()->resume();
@@ -672,8 +675,7 @@ void MainWindow::resume()
 
 void MainWindow::stop()
 {
-    positionTimer->stop();
-    lyricsTimer->stop();
+    frameTimer->stop();
     player->stop(true);
 
     ui->sliderPosition->setValue(0);
@@ -846,7 +848,7 @@ void MainWindow::keyPressEvent(QKeyEvent *event)
                 break;
             case Qt::Key_X:
                 if (ui->frameSearch->isVisible()) {
-                    setFrameSearch( db->search("") );
+                    db->search("");
                     ui->lbSearch->setText("_");
                     ui->frameSearch->show();
                     timer2->start(search_timeout);
@@ -904,7 +906,7 @@ void MainWindow::keyPressEvent(QKeyEvent *event)
 
                 if (dlg.removeConfirmed()) {
                     db->removeCurrentSong(dlg.removeFromStorage());
-                    setFrameSearch( db->searchNext() );
+                    db->searchNext();
                     if (ui->frameSearch->isVisible()) {
                         timer2->start(search_timeout);
                     }
@@ -1078,7 +1080,7 @@ void MainWindow::keyPressEvent(QKeyEvent *event)
                 searchBoxChangeBpm = false;
                 ui->lbSearch->setText(db->searchText() + "_");
             }
-            setFrameSearch( db->searchNext() );
+            db->searchNext();
             timer2->start(search_timeout);
         } else {
             searchBoxChangeBpm = false;
@@ -1086,7 +1088,7 @@ void MainWindow::keyPressEvent(QKeyEvent *event)
             db->currentSong()->setTranspose(0);
             ui->playlistWidget->hide();
             if (ui->lbId->text() == "")
-                setFrameSearch( db->search("") );
+                db->search("");
             ui->lbSearch->setText("_");
             showFrameSearch();
             ui->chMix->hide();
@@ -1100,7 +1102,7 @@ void MainWindow::keyPressEvent(QKeyEvent *event)
                 searchBoxChangeBpm = false;
                 ui->lbSearch->setText(db->searchText() + "_");
             }
-            setFrameSearch( db->searchPrevious() );
+            db->searchPrevious();
             timer2->start(search_timeout);
         } else {
             searchBoxChangeBpm = false;
@@ -1108,7 +1110,7 @@ void MainWindow::keyPressEvent(QKeyEvent *event)
             db->currentSong()->setTranspose(0);
             ui->playlistWidget->hide();
             if (ui->lbId->text() == "")
-                setFrameSearch( db->search("") );
+                db->search("");
             ui->lbSearch->setText("_");
             showFrameSearch();
             ui->chMix->hide();
@@ -1120,7 +1122,7 @@ void MainWindow::keyPressEvent(QKeyEvent *event)
         if (ui->frameSearch->isVisible()) {
             QString s = ui->lbSearch->text();
             s = s.replace(s.length() - 1, 1, "");
-            setFrameSearch( db->nextType(s) );
+            db->nextType(s);
             timer2->start(search_timeout);
         }
         break;
@@ -1132,7 +1134,7 @@ void MainWindow::keyPressEvent(QKeyEvent *event)
             }
             QString s = ui->lbSearch->text();
             s = s.replace(s.length() - 2, 2, "");
-            setFrameSearch( db->search(s) );
+            db->search(s);
             ui->lbSearch->setText(s + "_");
             timer2->start(search_timeout);
         }
@@ -1140,18 +1142,11 @@ void MainWindow::keyPressEvent(QKeyEvent *event)
     case Qt::Key_Enter:
     case Qt::Key_Return:
         if (ui->frameSearch->isVisible()) {
-            Song *s = db->currentSong();
-            ui->playlistWidget->addSong(s);
-
-            Song *songToAdd = new Song();
-            *songToAdd = *s;
-            playlist.append(songToAdd);
-
-            if (auto_playnext && playlist.count() == 1 && player->isPlayerStopped()) {
-                play(0);
-            } else {
-                hideUIFrame();
-            }
+            // the frame still shows the result of the text before
+            if (db->isSearchPending())
+                addWhenFound = true;
+            else
+                addSearchedSong();
         }
         if (ui->playlistWidget->isVisible() && ui->playlistWidget->rowCount() > 0) {
             ui->playlistWidget->hide();
@@ -1197,12 +1192,12 @@ void MainWindow::keyPressEvent(QKeyEvent *event)
             QString s = ui->lbSearch->text();
             s = s.replace(s.length() - 1, 1, "");
             ui->lbSearch->setText(s + event->text() + "_");
-            setFrameSearch( db->search(s + event->text()) );
+            db->search(s + event->text());
             timer2->start(search_timeout);
         } else {
             db->setSearchType(SearchType::ByAll);
             ui->lbSearch->setText(event->text() + "_");
-            setFrameSearch( db->search(event->text() ));
+            db->search(event->text());
             showFrameSearch();
             ui->chMix->hide();
             ui->expandChMix->hide();
@@ -1292,6 +1287,7 @@ void MainWindow::onChMixLockChanged(bool lock)
 
 void MainWindow::hideUIFrame()
 {
+    addWhenFound = false;
     ui->frameSearch->hide();
     ui->playlistWidget->hide();
     ui->songDetail->hide();
@@ -1325,6 +1321,36 @@ void MainWindow::setFrameSearch(Song *s)
     if (s->artist().length() == 0) {
         ui->lbBtw->hide();
     }
+
+    if (!db->hasSong()) {
+        ui->lbTempoKey->setText("");
+        ui->lbType->setText("");
+    }
+
+    if (addWhenFound && !db->isSearchPending()) {
+        addWhenFound = false;
+        if (ui->frameSearch->isVisible())
+            addSearchedSong();
+    }
+}
+
+void MainWindow::addSearchedSong()
+{
+    if (!db->hasSong())
+        return;
+
+    Song *s = db->currentSong();
+    ui->playlistWidget->addSong(s);
+
+    Song *songToAdd = new Song();
+    *songToAdd = *s;
+    playlist.append(songToAdd);
+
+    if (auto_playnext && playlist.count() == 1 && player->isPlayerStopped()) {
+        play(0);
+    } else {
+        hideUIFrame();
+    }
 }
 
 void MainWindow::showContextMenu(const QPoint &pos)
@@ -1610,22 +1636,51 @@ void MainWindow::showAboutQtDialog()
     QMessageBox::aboutQt(this);
 }
 
-void MainWindow::onPositiomTimerTimeOut()
+void MainWindow::onFrameTimerTimeOut()
 {
+    // one sample of the song position a frame, moved back by the audio still
+    // in the output buffer, so everything shows what is heard
+    MidiFile *midi = player->midiFile();
+    int latency = player->outputLatencyMs();
     int tick = player->positionTick();
-    ui->sliderPosition->setValue(tick);
+
+    long ms = static_cast<long>(midi->timeFromTick(tick) * 1000) - latency;
+
+    // the tempo map is walked once, the few ms of the latency and the lyrics
+    // lead of 25 ticks are taken at the current tempo
+    double ticksPerMs;
+    if (midi->divisionType() == MidiFile::PPQ)
+        ticksPerMs = player->currentBpm() * midi->resorution() / 60000.0;
+    else
+        ticksPerMs = midi->resorution() * -midi->divisionType() / 1000.0;    // smpte frames a second
+
+    int heardTick = tick;
+    long lyricsMs = ms;
+    if (ticksPerMs > 0) {
+        heardTick = qMax(0, tick - static_cast<int>(latency * ticksPerMs));
+        lyricsMs += static_cast<long>(25 / ticksPerMs);
+    }
+
+    ui->sliderPosition->setValue(heardTick);
     #ifdef _WIN32
-    taskbarButton->progress()->setValue(tick);
+    taskbarButton->progress()->setValue(heardTick);
     #endif
-    onPlayerPositionMSChanged(player->positionMs());
-    ui->rhmWidget->setCurrentBeat( player->currentBeat() );
+    onPlayerPositionMSChanged(qMax(0L, ms));
+    ui->rhmWidget->setCurrentBeat(static_cast<int>(midi->beatFromTick(heardTick)));
+
+    lyrWidget->setPositionMs(lyricsMs);
+    if (secondLyr != nullptr)
+        secondLyr->setPositionMs(lyricsMs);
 }
 
-void MainWindow::onLyricsTimerTimeOut()
+QVector<long> MainWindow::cursorTimes(const QVector<long> &cursors)
 {
-    lyrWidget->setPositionCursor(player->positionTick() + 25);
-    if (secondLyr != nullptr)
-        secondLyr->setPositionCursor(player->positionTick() + 25);
+    // song time as positionMs() counts it, the bpm speed is not in it
+    QVector<long> times;
+    times.reserve(cursors.count());
+    for (long tick : cursors)
+        times.append(static_cast<long>(player->midiFile()->timeFromTick(qMax(0L, tick)) * 1000));
+    return times;
 }
 
 void MainWindow::onPlayerDurationMSChanged(qint64 d)
@@ -1636,6 +1691,11 @@ void MainWindow::onPlayerDurationMSChanged(qint64 d)
 
 void MainWindow::onPlayerPositionMSChanged(qint64 p)
 {
+    // called every frame, the text changes once a second
+    if (p / 1000 == positionSec)
+        return;
+    positionSec = p / 1000;
+
     QDateTime t = QDateTime::fromMSecsSinceEpoch(p);
     ui->lbPosition->setText( locale.toString(t, "mm:ss") );
 }
@@ -1717,6 +1777,13 @@ void MainWindow::onPlayerThreadFinished()
     }
 }
 
+void MainWindow::onDbUpdateStarted()
+{
+    // the watcher's small updates run quietly
+    if (db->updateType() != UpdateType::UpdateChanged)
+        updateDetail->show();
+}
+
 void MainWindow::onDbUpdateChanged(int v)
 {
     int p = (100 * v / db->updateCount());
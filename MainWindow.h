@@ -81,11 +81,17 @@ protected:
 private:
     static void updateShutdownRequest();
 
+    // the song in the search frame to the playlist
+    void addSearchedSong();
+
+    // ms of each lyrics cursor, from the tempo map of the loaded song
+    QVector<long> cursorTimes(const QVector<long> &cursors);
+
 private:
     Ui::MainWindow *ui;
     QSettings *settings;
     SongDatabase *db;
-    QTimer *timer1, *timer2, *positionTimer, *lyricsTimer;
+    QTimer *timer1, *timer2, *frameTimer;
     QTimer *detailTimer;
 
     QList<Song*> playlist;
@@ -94,6 +100,8 @@ private:
     int playingIndex = -1;
     bool playAfterSeek = false;
     bool searchBoxChangeBpm = false;
+    // enter was pressed before the search answered
+    bool addWhenFound = false;
 
     LyricsWidget *lyrWidget, *secondLyr = nullptr;
     Detail *updateDetail;
@@ -105,6 +113,7 @@ private:
     int search_timeout = 5000;
     int playlist_timeout = 5000;
     int songDetail_timeout = 4000;
+    qint64 positionSec = -1;
 
     QLocale locale;
 
@@ -154,8 +163,7 @@ private slots:
     void showSpeakerDialog();
     void showVSTDirDialog();
 
-    void onPositiomTimerTimeOut();
-    void onLyricsTimerTimeOut();
+    void onFrameTimerTimeOut();
     void onPlayerDurationMSChanged(qint64 d);
     void onPlayerPositionMSChanged(qint64 p);
     void onPlayerDurationTickChanged(int d);
@@ -169,6 +177,7 @@ private slots:
 
     void onPlayerThreadFinished();
 
+    void onDbUpdateStarted();
     void onDbUpdateChanged(int v);
     void onDetailTimerTimeout();
 
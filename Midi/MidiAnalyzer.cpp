@@ -0,0 +1,429 @@
+#include "MidiAnalyzer.h"
+
+#include <QFile>
+#include <QStringList>
+
+#include <algorithm>
+#include <cstring>
+#include <set>
+#include <vector>
+
+
+namespace {
+
+// same tick: tempo and meter first, then controllers, note offs, note ons
+enum EventOrder
+{
+    OrderTempo = 0,
+    OrderTimeSignature = 0,
+    OrderController = 1,
+    OrderProgram = 1,
+    OrderNoteOff = 2,
+    OrderNoteOn = 3
+};
+
+enum EventKind
+{
+    KindTempo,
+    KindTimeSignature,
+    KindBank,
+    KindProgram,
+    KindNoteOff,
+    KindNoteOn,
+    KindEnd
+};
+
+typedef struct
+{
+    uint32_t tick;
+    int order;
+    int kind;
+    int channel;
+    int data1;
+    int data2;
+    uint32_t value;     // tempo in microseconds per quarter
+} Event;
+
+class Reader
+{
+public:
+    Reader(const unsigned char *data, int size) : p(data), end(data + size) {}
+
+    bool atEnd() const { return p >= end; }
+    int remaining() const { return static_cast<int>(end - p); }
+    const unsigned char *pos() const { return p; }
+
+    int byte()
+    {
+        return p < end ? *p++ : -1;
+    }
+
+    uint32_t be(int n)
+    {
+        uint32_t v = 0;
+        for (int i=0; i<n; i++)
+            v = (v << 8) | static_cast<uint32_t>(qMax(byte(), 0));
+        return v;
+    }
+
+    uint32_t vlq()
+    {
+        uint32_t v = 0;
+        for (int i=0; i<4; i++)
+        {
+            int b = byte();
+            if (b < 0)
+                break;
+            v = (v << 7) | (b & 0x7F);
+            if ((b & 0x80) == 0)
+                break;
+        }
+        return v;
+    }
+
+    void skip(uint32_t n)
+    {
+        p = n < static_cast<uint32_t>(remaining()) ? p + n : end;
+    }
+
+private:
+    const unsigned char *p;
+    const unsigned char *end;
+};
+
+void readTrack(Reader &in, std::vector<Event> &events)
+{
+    uint32_t tick = 0;
+    int running = 0;
+
+    while (!in.atEnd())
+    {
+        tick += in.vlq();
+
+        int status = in.byte();
+        if (status < 0)
+            break;
+
+        // running status, the byte read was the first data byte
+        int first = -1;
+        if (status < 0x80)
+        {
+            if (running == 0)
+                break;
+            first = status;
+            status = running;
+        }
+        else if (status < 0xF0)
+        {
+            running = status;
+        }
+
+        auto data = [&]() {
+            int b = first >= 0 ? first : in.byte();
+            first = -1;
+            return b & 0x7F;
+        };
+
+        Event e;
+        e.tick = tick;
+        e.channel = status & 0x0F;
+        e.data1 = 0;
+        e.data2 = 0;
+        e.value = 0;
+
+        switch (status & 0xF0)
+        {
+        case 0x80:
+        case 0x90:
+            e.data1 = data();
+            e.data2 = data();
+            if ((status & 0xF0) == 0x90 && e.data2 > 0)
+            {
+                e.kind = KindNoteOn;
+                e.order = OrderNoteOn;
+            }
+            else
+            {
+                e.kind = KindNoteOff;
+                e.order = OrderNoteOff;
+            }
+            events.push_back(e);
+            break;
+        case 0xA0:
+        case 0xE0:
+            data();
+            data();
+            break;
+        case 0xB0:
+            e.data1 = data();
+            e.data2 = data();
+            if (e.data1 == 0)
+            {
+                e.kind = KindBank;
+                e.order = OrderController;
+                events.push_back(e);
+            }
+            break;
+        case 0xC0:
+            e.data1 = data();
+            e.kind = KindProgram;
+            e.order = OrderProgram;
+            events.push_back(e);
+            break;
+        case 0xD0:
+            data();
+            break;
+        default:
+            if (status == 0xFF)
+            {
+                int type = in.byte();
+                uint32_t len = in.vlq();
+                const unsigned char *d = in.pos();
+                bool complete = len <= static_cast<uint32_t>(in.remaining());
+
+                if (type == 0x51 && len == 3 && complete)
+                {
+                    e.kind = KindTempo;
+                    e.order = OrderTempo;
+                    e.value = (d[0] << 16) | (d[1] << 8) | d[2];
+                    if (e.value > 0)
+                        events.push_back(e);
+                }
+                else if (type == 0x58 && len >= 2 && complete)
+                {
+                    e.kind = KindTimeSignature;
+                    e.order = OrderTimeSignature;
+                    e.data1 = d[0];
+                    e.data2 = d[1];
+                    events.push_back(e);
+                }
+
+                in.skip(len);
+
+                if (type == 0x2F)
+                {
+                    e.kind = KindEnd;
+                    e.order = OrderNoteOn;
+                    events.push_back(e);
+                    return;
+                }
+            }
+            else if (status == 0xF0 || status == 0xF7)
+            {
+                in.skip(in.vlq());
+            }
+            else
+            {
+                // system common messages don't belong in a file
+                return;
+            }
+            break;
+        }
+    }
+
+    Event e;
+    e.tick = tick;
+    e.kind = KindEnd;
+    e.order = OrderNoteOn;
+    e.channel = 0;
+    e.data1 = 0;
+    e.data2 = 0;
+    e.value = 0;
+    events.push_back(e);
+}
+
+QString joinSet(const std::set<int> &values)
+{
+    QStringList list;
+    for (int v : values)
+        list << QString::number(v);
+    return list.join(",");
+}
+
+} // namespace
+
+bool MidiAnalyzer::analyze(const QByteArray &smf, SongAnalysis *info)
+{
+    *info = SongAnalysis();
+
+    // rmid and some karaoke files have a header before MThd
+    int start = smf.indexOf("MThd");
+    if (start < 0)
+        return false;
+
+    Reader in(reinterpret_cast<const unsigned char*>(smf.constData()) + start, smf.size() - start);
+    in.skip(4);
+
+    uint32_t headerSize = in.be(4);
+    if (headerSize < 6)
+        return false;
+
+    in.be(2);   // format
+    int tracks = static_cast<int>(in.be(2));
+    int division = static_cast<int>(in.be(2));
+    in.skip(headerSize - 6);
+
+    if (division == 0)
+        return false;
+
+    std::vector<Event> events;
+
+    for (int t=0; t<tracks && in.remaining() >= 8; t++)
+    {
+        bool isTrack = memcmp(in.pos(), "MTrk", 4) == 0;
+        in.skip(4);
+        uint32_t size = in.be(4);
+
+        if (size > static_cast<uint32_t>(in.remaining()))
+            size = static_cast<uint32_t>(in.remaining());
+
+        if (isTrack)
+        {
+            Reader track(in.pos(), static_cast<int>(size));
+            readTrack(track, events);
+        }
+
+        in.skip(size);
+    }
+
+    std::stable_sort(events.begin(), events.end(), [](const Event &a, const Event &b) {
+        return a.tick < b.tick || (a.tick == b.tick && a.order < b.order);
+    });
+
+    // ticks to ms, smpte divisions have a fixed rate
+    double msPerTick = 0;
+    if (division & 0x8000)
+    {
+        int fps = -static_cast<signed char>(division >> 8);
+        double rate = fps == 29 ? 29.97 : fps;
+        if (rate <= 0 || (division & 0xFF) == 0)
+            return false;
+        msPerTick = 1000.0 / (rate * (division & 0xFF));
+    }
+
+    uint32_t tempo = 500000;
+    uint32_t lastTick = 0;
+    double ms = 0;
+
+    int program[16] = { 0 };
+    int bank[16] = { 0 };
+    std::vector<unsigned char> down(16 * 128, 0);
+    int keysDown = 0;
+
+    std::set<int> programs;
+    std::set<int> kits;
+    std::set<int> presets;      // bank << 8 | program
+    QStringList signatures;
+
+    int noteOns = 0;
+    double firstNote = -1;
+    double tempoMin = 0;
+    double tempoMax = 0;
+
+    for (const Event &e : events)
+    {
+        if (e.tick > lastTick)
+        {
+            uint32_t ticks = e.tick - lastTick;
+            ms += msPerTick > 0 ? ticks * msPerTick : ticks * (tempo / 1000.0) / division;
+            lastTick = e.tick;
+        }
+
+        switch (e.kind)
+        {
+        case KindTempo:
+            tempo = e.value;
+            break;
+        case KindTimeSignature: {
+            QString sig = QString::number(e.data1) + "/" + QString::number(1 << qMin(e.data2, 6));
+            if (signatures.isEmpty() || signatures.last() != sig)
+            {
+                if (!signatures.contains(sig))
+                    signatures << sig;
+            }
+            break;
+        }
+        case KindBank:
+            bank[e.channel] = e.data2;
+            break;
+        case KindProgram:
+            program[e.channel] = e.data1;
+            break;
+        case KindNoteOn: {
+            noteOns++;
+            if (firstNote < 0)
+                firstNote = ms;
+
+            double bpm = 60000000.0 / tempo;
+            if (noteOns == 1 || bpm < tempoMin)
+                tempoMin = bpm;
+            if (noteOns == 1 || bpm > tempoMax)
+                tempoMax = bpm;
+
+            info->channels |= 1 << e.channel;
+
+            if (e.channel == 9)
+            {
+                kits.insert(program[9]);
+                presets.insert(128 << 8 | program[9]);
+            }
+            else
+            {
+                programs.insert(program[e.channel]);
+                presets.insert(bank[e.channel] << 8 | program[e.channel]);
+            }
+
+            // a key struck again while down is still one voice
+            unsigned char &d = down[e.channel * 128 + e.data1];
+            if (d == 0)
+                keysDown++;
+            if (d < 255)
+                d++;
+            info->maxPolyphony = qMax(info->maxPolyphony, keysDown);
+            break;
+        }
+        case KindNoteOff: {
+            unsigned char &d = down[e.channel * 128 + e.data1];
+            if (d > 0 && --d == 0)
+                keysDown--;
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    QStringList presetList;
+    for (int p : presets)
+        presetList << QString::number(p >> 8) + ":" + QString::number(p & 0xFF);
+
+    info->valid = true;
+    info->durationMs = static_cast<int>(ms + 0.5);
+    info->tempoMin = static_cast<int>(tempoMin + 0.5);
+    info->tempoMax = static_cast<int>(tempoMax + 0.5);
+    info->timeSignatures = signatures.isEmpty() ? QString("4/4") : signatures.join(",");
+    info->programs = joinSet(programs);
+    info->drumKits = joinSet(kits);
+    info->presets = presetList.join(",");
+    info->noteDensity = ms > 0 ? static_cast<float>(noteOns * 1000.0 / ms) : 0;
+    info->firstNoteMs = firstNote < 0 ? 0 : static_cast<int>(firstNote + 0.5);
+
+    if (noteOns == 0)
+    {
+        info->tempoMin = info->tempoMax = static_cast<int>(60000000.0 / tempo + 0.5);
+    }
+
+    return true;
+}
+
+bool MidiAnalyzer::analyzeFile(const QString &midFilePath, SongAnalysis *info)
+{
+    QFile file(midFilePath);
+    if (!file.open(QFile::ReadOnly))
+    {
+        *info = SongAnalysis();
+        return false;
+    }
+
+    return analyze(file.readAll(), info);
+}
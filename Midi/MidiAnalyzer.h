@@ -0,0 +1,34 @@
+#ifndef MIDIANALYZER_H
+#define MIDIANALYZER_H
+
+#include <QByteArray>
+#include <QString>
+
+// what a song needs, read once when it is indexed
+typedef struct SongAnalysis
+{
+    bool valid;
+    int durationMs;
+    int tempoMin;               // bpm in effect at the notes
+    int tempoMax;
+    QString timeSignatures;     // "4/4,3/4" in order of appearance
+    int channels;               // a bit for each channel with notes
+    QString programs;           // melodic programs that play notes
+    QString drumKits;           // programs of channel 10
+    QString presets;            // soundfont "bank:program", drum kits in bank 128
+    float noteDensity;          // note ons per second
+    int maxPolyphony;           // keys down at once
+    int firstNoteMs;
+    SongAnalysis() : valid(false), durationMs(0), tempoMin(0), tempoMax(0), channels(0),
+        noteDensity(0), maxPolyphony(0), firstNoteMs(0) {}
+} SongAnalysis;
+
+class MidiAnalyzer
+{
+public:
+    // a standard midi file in memory, one pass without MidiEvent objects
+    static bool analyze(const QByteArray &smf, SongAnalysis *info);
+    static bool analyzeFile(const QString &midFilePath, SongAnalysis *info);
+};
+
+#endif // MIDIANALYZER_H
@@ -5,6 +5,7 @@
 
 #include <QString>
 #include <QList>
+#include <QVector>
 #include <QFile>
 
 class MidiFile
@@ -32,7 +33,7 @@ public:
     DivisionType divisionType() { return fDivision; }
 
     QString lyrics() { return fLyrics; }
-    QList<long> lyricsCursor() { return fLyricscursor; }
+    QVector<long> lyricsCursor() { return fLyricscursor; }
 
     QList<MidiEvent*> events() { return fEvents; }
     QList<MidiEvent*> tempoEvents() { return fTempoEvents; }
@@ -61,7 +62,7 @@ private:
     DivisionType fDivision;
 
     QString fLyrics;
-    QList<long> fLyricscursor;
+    QVector<long> fLyricscursor;
 
     QList<MidiEvent*> fEvents;
     QList<MidiEvent*> fTempoEvents;
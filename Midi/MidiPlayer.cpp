@@ -190,6 +190,11 @@ bool MidiPlayer::isUsedMidiSynthesizer()
     return false;
 }
 
+int MidiPlayer::outputLatencyMs()
+{
+    return isUsedMidiSynthesizer() ? _midiSynth->outputLatencyMs() : 0;
+}
+
 bool MidiPlayer::isPlayerPlaying()
 {
     return _midiSeq[_seqIndex]->isSeqPlaying();
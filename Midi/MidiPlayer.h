@@ -47,6 +47,8 @@ public:
     MidiFile* midiFile();
 
     bool isUsedMidiSynthesizer();
+    // how late the music is heard after it is played
+    int outputLatencyMs();
 
     bool isPlayerPlaying();
     bool isPlayerStopped();
@@ -9,7 +9,10 @@
 #include "BASSFX/ReverbFX.h"
 #include "BASSFX/VSTFX.h"
 
+#include <QDateTime>
+
 #include <cstring>
+#include <thread>
 
 
 MidiSynthesizer::MidiSynthesizer(QObject *parent) : QObject(parent)
@@ -19,11 +22,19 @@ MidiSynthesizer::MidiSynthesizer(QObject *parent) : QObject(parent)
 
     connect(&timer, SIGNAL(timeout()), this, SLOT(compactSoundfont()));
 
+    retireTimer.setInterval(CROSSFADE_MS);
+    connect(&retireTimer, SIGNAL(timeout()), this, SLOT(sweepRetired()));
+
+    governorTimer.setInterval(500);
+    connect(&governorTimer, SIGNAL(timeout()), this, SLOT(governVoices()));
+
     // create mixers
     for (int dv : outDevices.keys())
     {
         MixerHandle mixer;
         mixer.handle = 0;
+        mixer.reverbBus = 0;
+        mixer.chorusBus = 0;
 
         mixer.eq = new Equalizer31BandFX(0, 1);
         mixer.chorus = new Chorus2FX(0, 2);
@@ -73,15 +84,23 @@ MidiSynthesizer::MidiSynthesizer(QObject *parent) : QObject(parent)
         im.vsti = -1;
         im.device = 0;
         im.speaker = SpeakerType::Default;
+        im.reverbSend = 100;
+        im.chorusSend = 100;
+        im.reverbCC = 40;
+        im.chorusCC = 0;
 
         instMap[t] = im;
 
         handles[t] = 0;
+        sends[t] = { 0, 0, 0 };
+        voiceCaps[t] = 0;
     }
 
     for (int i=0; i<16; i++)
     {
         chInstType[i] = InstrumentType::Piano;
+        chReverb[i] = 40;
+        chChorus[i] = 0;
     }
     chInstType[9] = InstrumentType::PercussionEtc;
 }
@@ -89,6 +108,8 @@ MidiSynthesizer::MidiSynthesizer(QObject *parent) : QObject(parent)
 MidiSynthesizer::~MidiSynthesizer()
 {
     timer.stop();
+    retireTimer.stop();
+    governorTimer.stop();
 
     if (openned)
         close();
@@ -135,14 +156,41 @@ bool MidiSynthesizer::open()
 
     DWORD f = useFloat ? BASS_SAMPLE_FLOAT : 0;
 
+    // the mixer thread renders too, one core is already taken
+    if (useParallel)
+        renderer.start(static_cast<int>(std::thread::hardware_concurrency()) - 1);
+
     // create mixer, bus
     for (int i=0; i<mixers.count(); i++)
     {
         MixerHandle mixer = mixers[i];
         mixer.handle = BASS_Mixer_StreamCreate(44100, 8, f);
         mixer.eq->setStreamHandle(mixer.handle);
-        mixer.reverb->setStreamHandle(mixer.handle);
-        mixer.chorus->setStreamHandle(mixer.handle);
+
+        if (useAux)
+        {
+            // one reverb and one chorus per output, fed by instrument sends
+            DWORD bf = f|BASS_STREAM_DECODE|BASS_MIXER_NONSTOP;
+            mixer.reverbBus = BASS_Mixer_StreamCreate(44100, 2, bf);
+            mixer.chorusBus = BASS_Mixer_StreamCreate(44100, 2, bf);
+            BASS_Mixer_StreamAddChannel(mixer.handle, mixer.reverbBus, 0);
+            BASS_Mixer_StreamAddChannel(mixer.handle, mixer.chorusBus, 0);
+
+            mixer.reverb->setReturnMode(true);
+            mixer.chorus->setReturnMode(true);
+            mixer.reverb->setStreamHandle(mixer.reverbBus);
+            mixer.chorus->setStreamHandle(mixer.chorusBus);
+        }
+        else
+        {
+            mixer.reverbBus = 0;
+            mixer.chorusBus = 0;
+
+            mixer.reverb->setReturnMode(false);
+            mixer.chorus->setReturnMode(false);
+            mixer.reverb->setStreamHandle(mixer.handle);
+            mixer.chorus->setStreamHandle(mixer.handle);
+        }
 
         DWORD device = (i == 0) ? defaultDev : outDevices.keys()[i];
         BASS_ChannelSetDevice(mixer.handle, device);
@@ -156,21 +204,20 @@ bool MidiSynthesizer::open()
     {
         InstrumentType t = static_cast<InstrumentType>(i);
         handles[t] = createStream(t);
+        sends[t] = createSends(t);
     }
 
     // Check device.. volume .. mute.. solo.. bus.. and VST
+    calculateEnable();
     for (int i=0; i<HANDLE_STREAM_COUNT; i++)
     {
         InstrumentType t = static_cast<InstrumentType>(i);
-        setDevice(t, instMap[t].device);
-        setVolume(t, instMap[t].volume);
-        setMute(t, instMap[t].mute);
-        setSolo(t, instMap[t].solo);
-        setBusGroup(t, instMap[t].bus);  // speaker will set here
+        connectSends(t, sends[t], false);
+        applySends(t);
 
         // Set fx to stream handle
         for (FX *fx : instMap[t].FXs)
-            fx->setStreamHandle(handles[t]);
+            fx->setStreamHandle(sends[t].dry);
     }
 
     setSfToStream();
@@ -185,12 +232,14 @@ void MidiSynthesizer::close()
     if (!openned)
         return;
 
+    retireTimer.stop();
+    for (const RetiredHandle &r : retired)
+        freeRetired(r);
+    retired.clear();
+
     // Clear FX
     for (InstrumentType t : instMap.keys())
     {
-        if (t >= InstrumentType::BusGroup1)
-            break;
-
         for (FX *fx : instMap[t].FXs) {
             fx->setStreamHandle(0);
         }
@@ -199,11 +248,18 @@ void MidiSynthesizer::close()
     // clear handles
     for (InstrumentType t: handles.keys())
     {
-        if (t >= InstrumentType::BusGroup1)
-            break;
+        freeSends(sends[t]);
+        sends[t] = { 0, 0, 0 };
 
         HSTREAM h = handles[t];
 
+        if (t >= InstrumentType::BusGroup1)
+        {
+            BASS_StreamFree(h);
+            handles[t] = 0;
+            continue;
+        }
+
         if (t==InstrumentType::VSTi1 || t==InstrumentType::VSTi2
          || t==InstrumentType::VSTi3 || t==InstrumentType::VSTi4)
         {
@@ -220,11 +276,16 @@ void MidiSynthesizer::close()
             #endif
         }
         else
+        {
+            renderer.detach(h);
             BASS_StreamFree(h);
+        }
 
         handles[t] = 0;
     }
 
+    renderer.stop();
+
     // clear mixers fx
     for (int i=0; i<mixers.count(); i++)
     {
@@ -233,10 +294,14 @@ void MidiSynthesizer::close()
         mixer.reverb->setStreamHandle(0);
         mixer.chorus->setStreamHandle(0);
 
+        BASS_StreamFree(mixer.reverbBus);
+        BASS_StreamFree(mixer.chorusBus);
         BASS_ChannelStop(mixer.handle);
         BASS_StreamFree(mixer.handle);
 
         mixer.handle = 0;
+        mixer.reverbBus = 0;
+        mixer.chorusBus = 0;
         mixers[i] = mixer;
     }
 
@@ -289,6 +354,19 @@ void MidiSynthesizer::setVolume(float vol)
         BASS_ChannelSetAttribute(mix.handle, BASS_ATTRIB_VOL, vol);
 }
 
+int MidiSynthesizer::outputLatencyMs()
+{
+    if (!openned || mixers.isEmpty())
+        return 0;
+
+    DWORD handle = mixers[0].handle;
+    DWORD bytes = BASS_ChannelGetData(handle, NULL, BASS_DATA_AVAILABLE);
+    if (bytes == (DWORD)-1)
+        return 0;
+
+    return static_cast<int>(BASS_ChannelBytes2Seconds(handle, bytes) * 1000);
+}
+
 bool MidiSynthesizer::addSoundfont(const QString &sfFile)
 {
     #ifdef _WIN32
@@ -534,6 +612,9 @@ void MidiSynthesizer::sendNoteOff(int ch, int note, int velocity)
             #endif
         }
     }
+
+    // notes started before a stream was replaced are still held there
+    sendToRetired(ch, MIDI_EVENT_NOTE, MAKEWORD(note, 0));
 }
 
 void MidiSynthesizer::sendNoteOn(int ch, int note, int velocity)
@@ -660,8 +741,16 @@ void MidiSynthesizer::sendController(int ch, int number, int value)
     case 84:
         et = MIDI_EVENT_PORTANOTE; break;
     case 91:
+        if (ch >= 0 && ch < 16) {
+            chReverb[ch] = value;
+            setSendFromChannel(ch);
+        }
         et = MIDI_EVENT_REVERB; break;
     case 93:
+        if (ch >= 0 && ch < 16) {
+            chChorus[ch] = value;
+            setSendFromChannel(ch);
+        }
         et = MIDI_EVENT_CHORUS; break;
     case 94:
         et = MIDI_EVENT_USERFX; break;
@@ -705,6 +794,7 @@ void MidiSynthesizer::sendController(int ch, int number, int value)
                 BASS_VST_ProcessEventRaw(h, (void*)data, 3);
             #endif
         }
+        sendRawToRetired(data, 3);
         return;
     }
 
@@ -718,6 +808,7 @@ void MidiSynthesizer::sendProgramChange(int ch, int number)
     if (ch != 9) {
         InstrumentType t = MidiHelper::getInstrumentType(number);
         chInstType[ch] = t;
+        setSendFromChannel(ch);
     }
 }
 
@@ -742,6 +833,8 @@ void MidiSynthesizer::sendPitchBend(int ch, int value)
             BASS_VST_ProcessEvent(handles[t], ch, MIDI_EVENT_PITCH, value);
             #endif
         }
+
+        sendToRetired(ch, MIDI_EVENT_PITCH, value);
     }
 }
 
@@ -813,17 +906,26 @@ void MidiSynthesizer::setDevice(InstrumentType t, int device)
     if (t < InstrumentType::BusGroup1 && instMap[t].bus != -1)
         return;
 
+    if (instMap[t].device == device)
+        return;
+
     instMap[t].device = device;
 
     if (!openned)
         return;
 
-    if (t < InstrumentType::BusGroup1 && instMap[t].bus != -1)
-        return;
+    rebuildSends(t);
 
-    DWORD flag = MidiHelper::getSpeakerFlag(instMap[t].speaker);
-    BASS_Mixer_ChannelRemove(handles[t]);
-    BASS_Mixer_StreamAddChannel(mixers[device].handle, handles[t], flag);
+    if (t >= InstrumentType::BusGroup1 && useAux)
+    {
+        // sends of bus members return on the bus device
+        int group = static_cast<int>(t) - HANDLE_BUS_START;
+        for (const Instrument &im : instMap.values())
+        {
+            if (im.type < InstrumentType::BusGroup1 && im.bus == group)
+                rebuildSends(im.type);
+        }
+    }
 }
 
 void MidiSynthesizer::setBusGroup(InstrumentType t, int group)
@@ -831,25 +933,15 @@ void MidiSynthesizer::setBusGroup(InstrumentType t, int group)
     if (t >= InstrumentType::BusGroup1)
         return;
 
+    if (instMap[t].bus == group)
+        return;
+
     instMap[t].bus = group;
 
     if (!openned)
         return;
 
-    DWORD flag = MidiHelper::getSpeakerFlag(instMap[t].speaker);
-
-    BASS_Mixer_ChannelRemove(handles[t]);
-
-    if (group == -1)
-    {
-        DWORD mix = mixers[instMap[t].device].handle;
-        BASS_Mixer_StreamAddChannel(mix, handles[t], flag);
-    }
-    else
-    {
-        InstrumentType busType = static_cast<InstrumentType>(group + HANDLE_BUS_START);
-        BASS_Mixer_StreamAddChannel(handles[busType], handles[t], flag);
-    }
+    rebuildSends(t);
 }
 
 void MidiSynthesizer::setVolume(InstrumentType t, int volume)
@@ -867,7 +959,8 @@ void MidiSynthesizer::setVolume(InstrumentType t, int volume)
     if (!instMap[t].enable)
         return;
 
-    BASS_ChannelSetAttribute(handles[t], BASS_ATTRIB_VOL, instMap[t].volume / 100.0f);
+    BASS_ChannelSetAttribute(mixerSource(t), BASS_ATTRIB_VOL, instMap[t].volume / 100.0f);
+    applySends(t);
 }
 
 void MidiSynthesizer::setMute(InstrumentType t, bool m)
@@ -879,9 +972,11 @@ void MidiSynthesizer::setMute(InstrumentType t, bool m)
         return;
 
     if (m)
-        BASS_ChannelSetAttribute(handles[t], BASS_ATTRIB_VOL, 0.0f);
+        BASS_ChannelSetAttribute(mixerSource(t), BASS_ATTRIB_VOL, 0.0f);
     else
-        BASS_ChannelSetAttribute(handles[t], BASS_ATTRIB_VOL, instMap[t].volume / 100.0f);
+        BASS_ChannelSetAttribute(mixerSource(t), BASS_ATTRIB_VOL, instMap[t].volume / 100.0f);
+
+    applySends(t);
 }
 
 void MidiSynthesizer::setSolo(InstrumentType t, bool s)
@@ -906,9 +1001,11 @@ void MidiSynthesizer::setSolo(InstrumentType t, bool s)
     for (const Instrument itr : instMap.values()) {
 
         if (itr.enable)
-            BASS_ChannelSetAttribute(handles[itr.type], BASS_ATTRIB_VOL, itr.volume / 100.0f);
+            BASS_ChannelSetAttribute(mixerSource(itr.type), BASS_ATTRIB_VOL, itr.volume / 100.0f);
         else
-            BASS_ChannelSetAttribute(handles[itr.type], BASS_ATTRIB_VOL, 0.0f);
+            BASS_ChannelSetAttribute(mixerSource(itr.type), BASS_ATTRIB_VOL, 0.0f);
+
+        applySends(itr.type);
     }
 }
 
@@ -938,31 +1035,88 @@ void MidiSynthesizer::setSpeaker(InstrumentType t, SpeakerType speaker)
     if (t >= InstrumentType::BusGroup1)
         return;
 
+    if (instMap[t].speaker == speaker)
+        return;
+
+    bool stereo = MidiHelper::isStereoSpeaker(instMap[t].speaker);
     instMap[t].speaker = speaker;
 
-    if (!openned)
+    if (!openned || handles[t] == 0)
         return;
 
-    BASS_Mixer_ChannelRemove(handles[t]);
+    // same channel count, only the mixer flags change
+    if (MidiHelper::isStereoSpeaker(speaker) == stereo)
+    {
+        rebuildSends(t);
+        return;
+    }
+
+    bool vsti = t >= InstrumentType::VSTi1 && t <= InstrumentType::VSTi4;
+    HSTREAM old = handles[t];
+
     #ifndef __linux__
-    BASS_VST_ChannelFree(handles[t]);
+    if (vsti)
+    {
+        int vIndex = static_cast<int>(t) - HANDLE_VSTI_START;
+        mVstiTempProgram[vIndex] = BASS_VST_GetProgram(old);
+        mVstiTempParams[vIndex] = FX::getVSTParams(old);
+
+        DWORD length = 0;
+        char *chunk = BASS_VST_GetChunk(old, false, &length);
+        mVstiChunk[vIndex] = QByteArray(chunk, length);
+    }
     #endif
-    BASS_StreamFree(handles[t]);
 
-    handles[t] = createStream(t);
+    HSTREAM h = createStream(t);
+    if (h == 0)
+        return;
 
-    // Check device.. volume .. mute.. solo.. bus.. and VST
-    setDevice(t, instMap[t].device);
-    setVolume(t, instMap[t].volume);
-    setMute(t, instMap[t].mute);
-    setSolo(t, instMap[t].solo);
-    setBusGroup(t, instMap[t].bus); // speaker will set in here
+    // new notes go to the new stream, the old one keeps playing
+    // its held notes until they are released
+    if (!vsti)
+        copyMidiState(old, h);
 
-    // Set fx to stream handle
-    for (FX *fx : instMap[t].FXs)
-        fx->setStreamHandle(handles[t]);
+    handles[t] = h;
 
+    SendHandle oldSends = beginRebuild(t);
     setSoundfontPresets(sfPreset);
+    endRebuild(t, { 0, 0, 0 });
+
+    retire(old, vsti, oldSends, RELEASE_TIMEOUT_MS);
+}
+
+int MidiSynthesizer::reverbSend(InstrumentType t)
+{
+    return instMap[t].reverbSend;
+}
+
+int MidiSynthesizer::chorusSend(InstrumentType t)
+{
+    return instMap[t].chorusSend;
+}
+
+void MidiSynthesizer::setReverbSend(InstrumentType t, int level)
+{
+    if (level > 100)
+        instMap[t].reverbSend = 100;
+    else if (level < 0)
+        instMap[t].reverbSend = 0;
+    else
+        instMap[t].reverbSend = level;
+
+    applySends(t);
+}
+
+void MidiSynthesizer::setChorusSend(InstrumentType t, int level)
+{
+    if (level > 100)
+        instMap[t].chorusSend = 100;
+    else if (level < 0)
+        instMap[t].chorusSend = 0;
+    else
+        instMap[t].chorusSend = level;
+
+    applySends(t);
 }
 
 QStringList MidiSynthesizer::audioDevices()
@@ -1056,6 +1210,68 @@ void MidiSynthesizer::setUseFXRC(bool use)
     }
 }
 
+void MidiSynthesizer::setUseAuxBus(bool use)
+{
+    if (use == useAux)
+        return;
+
+    useAux = use;
+
+    if (!openned)
+        return;
+
+    close();
+    open();
+}
+
+void MidiSynthesizer::setUseGovernor(bool use)
+{
+    if (use == useGovernor)
+        return;
+
+    useGovernor = use;
+    govCalm = 0;
+
+    if (useGovernor)
+    {
+        governorTimer.start();
+        return;
+    }
+
+    governorTimer.stop();
+
+    // back to full quality
+    int oldLevel = govLevel;
+    govLevel = 0;
+
+    for (int i=0; i<HANDLE_VSTI_START; i++)
+        applyGovernor(static_cast<InstrumentType>(i), oldLevel);
+}
+
+void MidiSynthesizer::setCpuCeiling(int percent)
+{
+    if (percent > 100)
+        govCeiling = 100;
+    else if (percent < 10)
+        govCeiling = 10;
+    else
+        govCeiling = percent;
+}
+
+void MidiSynthesizer::setUseParallelRender(bool use)
+{
+    if (use == useParallel)
+        return;
+
+    useParallel = use;
+
+    if (!openned)
+        return;
+
+    close();
+    open();
+}
+
 HSTREAM MidiSynthesizer::getChannelHandle(InstrumentType type)
 {
     return handles[type];
@@ -1065,33 +1281,41 @@ FX *MidiSynthesizer::addFX(InstrumentType type, DWORD uid)
 {
     FX *fx = nullptr;
 
+    // build the new chain beside the playing one
+    bool rebuild = openned && handles[type] != 0;
+    SendHandle old = { 0, 0, 0 };
+    if (rebuild)
+        old = beginRebuild(type);
+
+    HSTREAM dry = sends[type].dry;
+
     if (uid < BUILTIN_FX_COUNT)
     {
         FXType fxType = static_cast<FXType>(uid);
         switch (fxType) {
         case FXType::AutoWah:
-            fx = new AutoWahFX(handles[type], instMap[type].FXs.count());
+            fx = new AutoWahFX(dry, instMap[type].FXs.count());
             break;
         case FXType::Chorus:
-            fx = new ChorusFX(handles[type], instMap[type].FXs.count());
+            fx = new ChorusFX(dry, instMap[type].FXs.count());
             break;
         case FXType::Compressor:
-            fx = new CompressorFX(handles[type], instMap[type].FXs.count());
+            fx = new CompressorFX(dry, instMap[type].FXs.count());
             break;
         case FXType::Distortion:
-            fx = new DistortionFX(handles[type], instMap[type].FXs.count());
+            fx = new DistortionFX(dry, instMap[type].FXs.count());
             break;
         case FXType::Echo:
-            fx = new EchoFX(handles[type], instMap[type].FXs.count());
+            fx = new EchoFX(dry, instMap[type].FXs.count());
             break;
         case FXType::EQ15Band:
-            fx = new Equalizer15BandFX(handles[type], instMap[type].FXs.count());
+            fx = new Equalizer15BandFX(dry, instMap[type].FXs.count());
             break;
         case FXType::EQ31Band:
-            fx = new Equalizer31BandFX(handles[type], instMap[type].FXs.count());
+            fx = new Equalizer31BandFX(dry, instMap[type].FXs.count());
             break;
         case FXType::Reverb:
-            fx = new ReverbFX(handles[type], instMap[type].FXs.count());
+            fx = new ReverbFX(dry, instMap[type].FXs.count());
             break;
         }
     }
@@ -1099,7 +1323,7 @@ FX *MidiSynthesizer::addFX(InstrumentType type, DWORD uid)
     {
         #ifndef __linux__
         if (_vstList.contains(uid))
-            fx = new VSTFX(_vstList[uid].vstPath, handles[type], instMap[type].FXs.count());
+            fx = new VSTFX(_vstList[uid].vstPath, dry, instMap[type].FXs.count());
         else
             fx = nullptr;
         #endif
@@ -1111,6 +1335,9 @@ FX *MidiSynthesizer::addFX(InstrumentType type, DWORD uid)
         instMap[type].FXs.append(fx);
     }
 
+    if (rebuild)
+        endRebuild(type, old);
+
     return fx;
 }
 
@@ -1119,7 +1346,17 @@ bool MidiSynthesizer::removeFX(InstrumentType type, int fxIndex)
     if (fxIndex >= instMap[type].FXs.count())
         return false;
 
-    delete instMap[type].FXs.takeAt(fxIndex);
+    FX *fx = instMap[type].FXs.takeAt(fxIndex);
+
+    if (openned && handles[type] != 0)
+    {
+        // the removed fx stays on the old chain while it fades out
+        SendHandle old = beginRebuild(type);
+        fx->moveStreamHandle(0);
+        endRebuild(type, old);
+    }
+
+    delete fx;
 
     return true;
 }
@@ -1262,10 +1499,11 @@ DWORD MidiSynthesizer::setVSTiFile(int vstiIndex, const QString &file)
     if (!openned)
         return 0;
 
-    BASS_Mixer_ChannelRemove(vsti);
-    BASS_VST_ChannelFree(vsti);
+    if (vsti != 0)
+        retire(vsti, true, sends[t], 0);
 
     vsti = createStream(t);
+    handles[t] = vsti;
 
     if (vsti)
     {
@@ -1274,26 +1512,13 @@ DWORD MidiSynthesizer::setVSTiFile(int vstiIndex, const QString &file)
         mVstiInfos[vstiIndex] = vstinfo;
         mVstiTempProgram[vstiIndex] = 0;
         mVstiTempParams[vstiIndex].clear();
+    }
 
-        handles[t] = vsti;
-
-        setDevice(t, instMap[t].device);
-        setVolume(t, instMap[t].volume);
-        setMute(t, instMap[t].mute);
-        setSolo(t, instMap[t].solo);
-        setBusGroup(t, instMap[t].bus); // speaker will set here
-
-        // Set stream handle to FX
-        for (FX *fx : instMap[t].FXs)
-            fx->setStreamHandle(vsti);
+    // Set stream handle to FX
+    beginRebuild(t);
+    endRebuild(t, { 0, 0, 0 });
 
-        return vsti;
-    }
-    else
-    {
-        handles[t] = 0;
-        return 0;
-    }
+    return vsti;
 }
 
 void MidiSynthesizer::removeVSTiFile(int vstiIndex)
@@ -1304,10 +1529,14 @@ void MidiSynthesizer::removeVSTiFile(int vstiIndex)
     InstrumentType t = static_cast<InstrumentType>(HANDLE_VSTI_START+vstiIndex);
     DWORD vsti = handles[t];
 
-    BASS_Mixer_ChannelRemove(vsti);
-    BASS_VST_ChannelFree(vsti);
+    if (vsti != 0)
+    {
+        retire(vsti, true, sends[t], 0);
+
+        handles[t] = 0;
+        beginRebuild(t);
+    }
 
-    handles[t] = 0;
     mVstiFiles[vstiIndex] = "";
     mVstiInfos[vstiIndex] = BASS_VST_INFO();
     mVstiTempProgram[vstiIndex] = 0;
@@ -1331,12 +1560,23 @@ DWORD MidiSynthesizer::createStream(InstrumentType t)
     {
         if (index < HANDLE_MIDI_COUNT-4) // Midi
         {
-             DWORD flags = f|BASS_STREAM_DECODE|BASS_MIDI_SINCINTER;
+             int steps = governorSteps(t, govLevel);
+
+             DWORD flags = f|BASS_STREAM_DECODE;
+             if (steps == 0) flags = flags|BASS_MIDI_SINCINTER;
              if (!useFX) flags = flags|BASS_MIDI_NOFX;
              if (!MidiHelper::isStereoSpeaker(instMap[t].speaker))
                  flags = flags|BASS_SAMPLE_MONO;
 
-            return BASS_MIDI_StreamCreate(16, flags, 44100);
+            HSTREAM h = BASS_MIDI_StreamCreate(16, flags, 44100);
+            if (h != 0 && steps > 0 && voiceCaps[t] > 0)
+                BASS_ChannelSetAttribute(h, BASS_ATTRIB_MIDI_VOICES, voiceCaps[t]);
+
+            // vsti plugins stay on the mixer thread
+            if (h != 0)
+                renderer.attach(h);
+
+            return h;
         }
         else // VSTi
         {
@@ -1387,6 +1627,8 @@ void MidiSynthesizer::sendToAllMidiStream(int ch, DWORD eventType, DWORD param)
             BASS_VST_ProcessEvent(stream, ch, eventType, param);
         #endif
     }
+
+    sendToRetired(ch, eventType, param);
 }
 
 void MidiSynthesizer::setSfToStream()
@@ -1524,4 +1766,449 @@ HSTREAM MidiSynthesizer::getDrumHandleFromNote(int drumNote)
     }
 }
 
+DWORD MidiSynthesizer::mixerSource(InstrumentType t)
+{
+    HSTREAM dry = sends[t].dry;
+    return dry != 0 ? dry : handles[t];
+}
+
+DWORD MidiSynthesizer::renderSource(HSTREAM h)
+{
+    // the splitters read the pre-rendered feed of a parallel stream
+    HSTREAM feed = renderer.feed(h);
+    return feed != 0 ? feed : h;
+}
+
+SendHandle MidiSynthesizer::createSends(InstrumentType t)
+{
+    SendHandle sh = { 0, 0, 0 };
+
+    if (handles[t] == 0)
+        return sh;
+
+    // the mixer always reads a splitter, so the connection can be
+    // replaced without touching the source
+    DWORD src = renderSource(handles[t]);
+    sh.dry = BASS_Split_StreamCreate(src, BASS_STREAM_DECODE, NULL);
+
+    if (useAux && t < InstrumentType::BusGroup1)
+    {
+        sh.reverb = BASS_Split_StreamCreate(src, BASS_STREAM_DECODE, NULL);
+        sh.chorus = BASS_Split_StreamCreate(src, BASS_STREAM_DECODE, NULL);
+    }
+
+    return sh;
+}
+
+void MidiSynthesizer::connectSends(InstrumentType t, const SendHandle &sh, bool fadeIn)
+{
+    if (!openned || sh.dry == 0)
+        return;
+
+    const Instrument &im = instMap[t];
+
+    int dv = im.device;
+    if (t < InstrumentType::BusGroup1 && im.bus != -1)
+        dv = instMap[static_cast<InstrumentType>(im.bus + HANDLE_BUS_START)].device;
+
+    if (dv < 0 || dv >= mixers.count())
+        dv = 0;
+
+    DWORD target = mixers[dv].handle;
+    if (t < InstrumentType::BusGroup1 && im.bus != -1)
+        target = handles[static_cast<InstrumentType>(im.bus + HANDLE_BUS_START)];
+
+    float fader = im.enable ? im.volume / 100.0f : 0.0f;
+
+    BASS_ChannelSetAttribute(sh.dry, BASS_ATTRIB_VOL, fadeIn ? 0.0f : fader);
+    BASS_Mixer_StreamAddChannel(target, sh.dry, MidiHelper::getSpeakerFlag(im.speaker));
+    if (fadeIn)
+        BASS_ChannelSlideAttribute(sh.dry, BASS_ATTRIB_VOL, fader, CROSSFADE_MS);
+
+    // start paused, applySends will wake the ones with a level
+    if (sh.reverb != 0)
+        BASS_Mixer_StreamAddChannel(mixers[dv].reverbBus, sh.reverb, BASS_MIXER_PAUSE);
+    if (sh.chorus != 0)
+        BASS_Mixer_StreamAddChannel(mixers[dv].chorusBus, sh.chorus, BASS_MIXER_PAUSE);
+}
+
+void MidiSynthesizer::freeSends(const SendHandle &sh)
+{
+    if (sh.dry != 0)
+        BASS_StreamFree(sh.dry);
+    if (sh.reverb != 0)
+        BASS_StreamFree(sh.reverb);
+    if (sh.chorus != 0)
+        BASS_StreamFree(sh.chorus);
+}
+
+void MidiSynthesizer::applySends(InstrumentType t)
+{
+    SendHandle sh = sends[t];
+    if (!openned || sh.dry == 0)
+        return;
+
+    const Instrument &im = instMap[t];
+
+    // post fader, splitters do not carry the source volume
+    float fader = im.enable ? im.volume / 100.0f : 0.0f;
+
+    setSendLevel(sh.reverb, fader * im.reverbSend / 100.0f * im.reverbCC / 127.0f);
+    setSendLevel(sh.chorus, fader * im.chorusSend / 100.0f * im.chorusCC / 127.0f);
+}
+
+void MidiSynthesizer::setSendLevel(HSTREAM split, float level)
+{
+    if (split == 0)
+        return;
+
+    bool paused = BASS_Mixer_ChannelFlags(split, 0, 0) & BASS_MIXER_PAUSE;
+
+    // idle sends are paused so the aux mixer skips them
+    if (level <= 0.0f)
+    {
+        BASS_ChannelSetAttribute(split, BASS_ATTRIB_VOL, 0.0f);
+        if (!paused)
+            BASS_Mixer_ChannelFlags(split, BASS_MIXER_PAUSE, BASS_MIXER_PAUSE);
+        return;
+    }
+
+    if (paused)
+    {
+        // drop the data queued while it was paused
+        BASS_Split_StreamReset(split);
+        BASS_ChannelSetAttribute(split, BASS_ATTRIB_VOL, 0.0f);
+        BASS_Mixer_ChannelFlags(split, 0, BASS_MIXER_PAUSE);
+    }
+
+    BASS_ChannelSlideAttribute(split, BASS_ATTRIB_VOL, level, CROSSFADE_MS);
+}
+
+void MidiSynthesizer::setSendFromChannel(int ch)
+{
+    QList<InstrumentType> types;
+
+    if (ch == 9)
+    {
+        int first = static_cast<int>(InstrumentType::BassDrum);
+        int last = static_cast<int>(InstrumentType::PercussionEtc);
+        for (int i=first; i<=last; i++)
+            types.append(static_cast<InstrumentType>(i));
+    }
+    else
+    {
+        types.append(chInstType[ch]);
+    }
+
+    for (InstrumentType t : types)
+    {
+        if (instMap[t].vsti != -1)
+            t = static_cast<InstrumentType>(instMap[t].vsti + HANDLE_VSTI_START);
+
+        instMap[t].reverbCC = chReverb[ch];
+        instMap[t].chorusCC = chChorus[ch];
+
+        applySends(t);
+    }
+}
+
+SendHandle MidiSynthesizer::beginRebuild(InstrumentType t)
+{
+    SendHandle old = sends[t];
+    sends[t] = createSends(t);
+
+    for (FX *fx : instMap[t].FXs)
+        fx->moveStreamHandle(sends[t].dry);
+
+    return old;
+}
+
+void MidiSynthesizer::endRebuild(InstrumentType t, const SendHandle &old)
+{
+    connectSends(t, sends[t], true);
+    applySends(t);
+
+    if (old.dry != 0)
+        retire(0, false, old, 0);
+}
+
+void MidiSynthesizer::rebuildSends(InstrumentType t)
+{
+    if (!openned || handles[t] == 0)
+        return;
+
+    endRebuild(t, beginRebuild(t));
+}
+
+void MidiSynthesizer::retire(HSTREAM source, bool vsti, const SendHandle &sh, int releaseMs)
+{
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+
+    RetiredHandle r;
+    r.source = source;
+    r.vsti = vsti;
+    r.sends = sh;
+    r.releaseUntil = now + releaseMs;
+    r.freeAt = 0;
+
+    if (releaseMs <= 0)
+    {
+        BASS_ChannelSlideAttribute(sh.dry, BASS_ATTRIB_VOL, 0.0f, CROSSFADE_MS);
+        BASS_ChannelSlideAttribute(sh.reverb, BASS_ATTRIB_VOL, 0.0f, CROSSFADE_MS);
+        BASS_ChannelSlideAttribute(sh.chorus, BASS_ATTRIB_VOL, 0.0f, CROSSFADE_MS);
+        r.freeAt = now + CROSSFADE_MS * 2;
+    }
+
+    retired.append(r);
+
+    if (!retireTimer.isActive())
+        retireTimer.start();
+}
+
+void MidiSynthesizer::freeRetired(const RetiredHandle &r)
+{
+    freeSends(r.sends);
+
+    if (r.source == 0)
+        return;
+
+    if (r.vsti)
+    {
+        #ifndef __linux__
+        BASS_VST_ChannelFree(r.source);
+        #endif
+    }
+    else
+    {
+        renderer.detach(r.source);
+        BASS_StreamFree(r.source);
+    }
+}
+
+void MidiSynthesizer::sweepRetired()
+{
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+
+    for (int i=retired.count()-1; i>=0; i--)
+    {
+        RetiredHandle &r = retired[i];
+
+        if (r.freeAt == 0)
+        {
+            // vsti voices are unknown, they get the whole release time
+            bool sounding = now < r.releaseUntil;
+            if (sounding && !r.vsti)
+            {
+                float voices = 0;
+                BASS_ChannelGetAttribute(r.source, BASS_ATTRIB_MIDI_VOICES_ACTIVE, &voices);
+                sounding = voices > 0;
+            }
+
+            if (sounding)
+                continue;
+
+            BASS_ChannelSlideAttribute(r.sends.dry, BASS_ATTRIB_VOL, 0.0f, CROSSFADE_MS);
+            BASS_ChannelSlideAttribute(r.sends.reverb, BASS_ATTRIB_VOL, 0.0f, CROSSFADE_MS);
+            BASS_ChannelSlideAttribute(r.sends.chorus, BASS_ATTRIB_VOL, 0.0f, CROSSFADE_MS);
+            r.freeAt = now + CROSSFADE_MS * 2;
+        }
+        else if (now >= r.freeAt)
+        {
+            freeRetired(r);
+            retired.removeAt(i);
+        }
+    }
+
+    if (retired.isEmpty())
+        retireTimer.stop();
+}
+
+void MidiSynthesizer::sendToRetired(int ch, DWORD eventType, DWORD param)
+{
+    for (const RetiredHandle &r : retired)
+    {
+        if (r.source == 0)
+            continue;
+
+        if (!r.vsti)
+            BASS_MIDI_StreamEvent(r.source, ch, eventType, param);
+        #ifndef __linux__
+        else
+            BASS_VST_ProcessEvent(r.source, ch, eventType, param);
+        #endif
+    }
+}
+
+void MidiSynthesizer::sendRawToRetired(BYTE *data, int length)
+{
+    for (const RetiredHandle &r : retired)
+    {
+        if (r.source == 0)
+            continue;
+
+        if (!r.vsti)
+            BASS_MIDI_StreamEvents(r.source, BASS_MIDI_EVENTS_RAW, data, length);
+        #ifndef __linux__
+        else
+            BASS_VST_ProcessEventRaw(r.source, (void*)data, length);
+        #endif
+    }
+}
+
+void MidiSynthesizer::copyMidiState(HSTREAM from, HSTREAM to)
+{
+    // bank before program, program before the controllers
+    static const DWORD events[] = {
+        MIDI_EVENT_DRUMS, MIDI_EVENT_BANK, MIDI_EVENT_BANK_LSB, MIDI_EVENT_PROGRAM,
+        MIDI_EVENT_PITCHRANGE, MIDI_EVENT_FINETUNE, MIDI_EVENT_COARSETUNE,
+        MIDI_EVENT_MODULATION, MIDI_EVENT_VOLUME, MIDI_EVENT_PAN, MIDI_EVENT_EXPRESSION,
+        MIDI_EVENT_SUSTAIN, MIDI_EVENT_SOFT, MIDI_EVENT_PORTAMENTO, MIDI_EVENT_PORTATIME,
+        MIDI_EVENT_REVERB, MIDI_EVENT_CHORUS, MIDI_EVENT_CUTOFF, MIDI_EVENT_RESONANCE,
+        MIDI_EVENT_ATTACK, MIDI_EVENT_DECAY, MIDI_EVENT_RELEASE,
+        MIDI_EVENT_PITCH, MIDI_EVENT_CHANPRES
+    };
+
+    for (int ch=0; ch<16; ch++)
+    {
+        for (DWORD ev : events)
+        {
+            DWORD v = BASS_MIDI_StreamGetEvent(from, ch, ev);
+            if (v != static_cast<DWORD>(-1))
+                BASS_MIDI_StreamEvent(to, ch, ev, v);
+        }
+    }
+}
+
+void MidiSynthesizer::governVoices()
+{
+    if (!openned)
+        return;
+
+    // BASS_GetCPU covers the decoding done in the update thread. With the
+    // parallel renderer the streams decode on its workers, its periods are
+    // timed against the audio they render
+    float load = BASS_GetCPU();
+
+    if (renderer.isRunning())
+        load = qMax(load, renderer.takeLoad());
+
+    int level = govLevel;
+
+    if (load > govCeiling)
+    {
+        govCalm = 0;
+        if (level < GOVERNOR_MAX_LEVEL)
+            level++;
+    }
+    else if (load < govCeiling * 0.6f)
+    {
+        // relax one step per 2 s of headroom
+        if (++govCalm >= 4 && level > 0)
+        {
+            level--;
+            govCalm = 0;
+        }
+    }
+    else
+    {
+        govCalm = 0;
+    }
+
+    if (level == govLevel)
+        return;
+
+    int oldLevel = govLevel;
+    govLevel = level;
+
+    for (int i=0; i<HANDLE_VSTI_START; i++)
+        applyGovernor(static_cast<InstrumentType>(i), oldLevel);
+}
+
+int MidiSynthesizer::voiceTier(InstrumentType t)
+{
+    switch (t) {
+
+    // melody, bass and the main beat
+    case InstrumentType::Piano:
+    case InstrumentType::Bass:
+    case InstrumentType::AcousticGuitarNylon:
+    case InstrumentType::AcousticGuitarSteel:
+    case InstrumentType::ElectricGuitarJazz:
+    case InstrumentType::ElectricGuitarClean:
+    case InstrumentType::Trumpet:
+    case InstrumentType::Saxophone:
+    case InstrumentType::Reed:
+    case InstrumentType::Pipe:
+    case InstrumentType::SynthLead:
+    case InstrumentType::BassDrum:
+    case InstrumentType::Snare:
+    case InstrumentType::Hihat:
+        return 0;
+
+    // pads, effects and washes
+    case InstrumentType::Strings:
+    case InstrumentType::Ensemble:
+    case InstrumentType::SynthPad:
+    case InstrumentType::SynthEffects:
+    case InstrumentType::SoundEffects:
+    case InstrumentType::Percussive:
+    case InstrumentType::CrashCymbal:
+    case InstrumentType::RideCymbal:
+    case InstrumentType::PercussionEtc:
+        return 2;
+
+    default:
+        return 1;
+    }
+}
+
+int MidiSynthesizer::governorSteps(InstrumentType t, int level)
+{
+    // pads give way first, melody and bass last
+    int steps = level - (2 - voiceTier(t));
+    return steps > 0 ? steps : 0;
+}
+
+void MidiSynthesizer::applyGovernor(InstrumentType t, int oldLevel)
+{
+    int prev = governorSteps(t, oldLevel);
+    int steps = governorSteps(t, govLevel);
+
+    if (steps == prev)
+        return;
+
+    int maxVoices = static_cast<int>(BASS_GetConfig(BASS_CONFIG_MIDI_VOICES));
+    int cap = voiceCaps[t];
+    HSTREAM h = handles[t];
+
+    if (steps == 0)
+    {
+        cap = 0;
+    }
+    else if (steps > prev)
+    {
+        // halve what is sounding now, not the configured maximum
+        float active = 0;
+        BASS_ChannelGetAttribute(h, BASS_ATTRIB_MIDI_VOICES_ACTIVE, &active);
+
+        int base = qMax(static_cast<int>(active), GOVERNOR_MIN_VOICES * 2);
+        if (cap > 0)
+            base = qMin(base, cap);
+
+        cap = qMax(GOVERNOR_MIN_VOICES, base >> (steps - prev));
+    }
+    else
+    {
+        cap = qMin(maxVoices, cap << (prev - steps));
+    }
+
+    voiceCaps[t] = cap;
+
+    if (h == 0)
+        return;
+
+    BASS_ChannelSetAttribute(h, BASS_ATTRIB_MIDI_VOICES, cap > 0 ? cap : maxVoices);
+    BASS_ChannelFlags(h, steps > 0 ? 0 : BASS_MIDI_SINCINTER, BASS_MIDI_SINCINTER);
+}
+
 QMap<int, QString> MidiSynthesizer::outDevices;
@@ -11,6 +11,7 @@
 #include <bass_fx.h>
 
 #include "Midi/MidiHelper.h"
+#include "Midi/ParallelRenderer.h"
 #include "BASSFX/FX.h"
 #include "BASSFX/Equalizer31BandFX.h"
 #include "BASSFX/Chorus2FX.h"
@@ -21,6 +22,8 @@
 typedef struct
 {
     DWORD handle;
+    DWORD reverbBus;
+    DWORD chorusBus;
     Equalizer31BandFX *eq;
     Chorus2FX *chorus;
     Reverb2FX *reverb;
@@ -37,9 +40,32 @@ typedef struct
     int vsti;
     int device;
     SpeakerType speaker;
+    int reverbSend;
+    int chorusSend;
+    int reverbCC;
+    int chorusCC;
     QList<FX*> FXs;
 } Instrument;
 
+// splitter streams of an instrument, dry goes to the mixer or bus
+// (with the instrument fx), reverb and chorus only when aux buses are used
+typedef struct
+{
+    HSTREAM dry;
+    HSTREAM reverb;
+    HSTREAM chorus;
+} SendHandle;
+
+// replaced streams, kept until their notes are released and faded out
+typedef struct
+{
+    HSTREAM source;     // 0 when only the splitters were replaced
+    bool vsti;
+    SendHandle sends;
+    qint64 releaseUntil;
+    qint64 freeAt;      // 0 until the fade out has started
+} RetiredHandle;
+
 typedef struct
 {
     unsigned int uniqueID;
@@ -65,6 +91,8 @@ public:
     bool setDefaultDevice(int dv);
     void setVolume(float vol);
     float volume() { return synth_volume; }
+    // audio rendered but not heard yet, on the main output
+    int outputLatencyMs();
 
     QStringList soundfontFiles() { return sfFiles; }
     bool addSoundfont(const QString &sfFile);
@@ -116,6 +144,12 @@ public:
     void setUseVSTi(InstrumentType t, int vstiIndex);
     void setSpeaker(InstrumentType t, SpeakerType speaker);
 
+    // Aux send/return, send level = mixer send (0-100) * CC91/CC93
+    int  reverbSend(InstrumentType t);
+    int  chorusSend(InstrumentType t);
+    void setReverbSend(InstrumentType t, int level);
+    void setChorusSend(InstrumentType t, int level);
+
 
     static QStringList audioDevices();
     static void audioDevices(const QMap<int, QString> &devices);
@@ -137,6 +171,21 @@ public:
     bool isUseFXRC() { return useFX; }
     void setUseFXRC(bool use);
 
+    bool isUseAuxBus() { return useAux; }
+    void setUseAuxBus(bool use);
+
+    // CPU governor, trades voices and interpolation of the less
+    // important streams for headroom when the load nears the ceiling
+    bool isUseGovernor() { return useGovernor; }
+    void setUseGovernor(bool use);
+    int  cpuCeiling() { return govCeiling; }
+    void setCpuCeiling(int percent);
+    int  governorLevel() { return govLevel; }
+
+    // decode the midi streams on all cores, takes effect on open
+    bool isUseParallelRender() { return useParallel; }
+    void setUseParallelRender(bool use);
+
     HSTREAM getChannelHandle(InstrumentType type);
 
     FX* addFX(InstrumentType type, DWORD uid);
@@ -170,6 +219,10 @@ public:
 public slots:
     void compactSoundfont();
 
+private slots:
+    void sweepRetired();
+    void governVoices();
+
 signals:
     void noteOnSended(InstrumentType t, int bus, int ch, int note, int velocity);
 
@@ -181,13 +234,43 @@ private:
     void calculateEnable();
     HSTREAM getDrumHandleFromNote(int drumNote);
 
+    DWORD mixerSource(InstrumentType t);
+    DWORD renderSource(HSTREAM h);
+    SendHandle createSends(InstrumentType t);
+    void connectSends(InstrumentType t, const SendHandle &sh, bool fadeIn);
+    void freeSends(const SendHandle &sh);
+    void applySends(InstrumentType t);
+    void setSendLevel(HSTREAM split, float level);
+    void setSendFromChannel(int ch);
+
+    // glitch free routing and fx changes, new splitters fade in
+    // while the old ones fade out
+    SendHandle beginRebuild(InstrumentType t);
+    void endRebuild(InstrumentType t, const SendHandle &old);
+    void rebuildSends(InstrumentType t);
+    void retire(HSTREAM source, bool vsti, const SendHandle &sh, int releaseMs);
+    void freeRetired(const RetiredHandle &r);
+    void sendToRetired(int ch, DWORD eventType, DWORD param);
+    void sendRawToRetired(BYTE *data, int length);
+    void copyMidiState(HSTREAM from, HSTREAM to);
+
+    static int voiceTier(InstrumentType t);
+    int governorSteps(InstrumentType t, int level);
+    void applyGovernor(InstrumentType t, int oldLevel);
+
 private:
     QTimer timer;
+    QTimer retireTimer;
+    QTimer governorTimer;
+
+    ParallelRenderer renderer;
 
     QList<MixerHandle> mixers;
     //MixerManager mixers;
     //HSTREAM mixHandle;
     QMap<InstrumentType, HSTREAM> handles;
+    QMap<InstrumentType, SendHandle> sends;
+    QList<RetiredHandle> retired;
     QList<HSOUNDFONT> synth_HSOUNDFONT;
     int sfPreset = 0;
     QStringList sfFiles;
@@ -195,6 +278,9 @@ private:
     QList<QList<int>> drumSf;
     QMap<InstrumentType, Instrument> instMap;
     InstrumentType chInstType[16];
+    QMap<InstrumentType, int> voiceCaps;
+    int chReverb[16];
+    int chChorus[16];
 
     #ifndef __linux__
     QString mVstiFiles[4];
@@ -215,10 +301,21 @@ private:
     int defaultDev = 1;
     bool useFloat = true;
     bool useFX = false;
+    bool useAux = false;
+    bool useGovernor = false;
+    int govCeiling = 75;
+    int govLevel = 0;
+    int govCalm = 0;
+    bool useParallel = true;
     bool sfLoadAll = false;
 
     DWORD RPNType = 0;
 
+    const int CROSSFADE_MS = 20;
+    const int RELEASE_TIMEOUT_MS = 8000;
+    const int GOVERNOR_MAX_LEVEL = 4;
+    const int GOVERNOR_MIN_VOICES = 16;
+
     // device number, name
     static QMap<int, QString> outDevices;
 };
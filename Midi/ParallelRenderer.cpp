@@ -0,0 +1,398 @@
+#include "ParallelRenderer.h"
+
+#include <chrono>
+#include <cstring>
+
+
+ParallelRenderer::ParallelRenderer()
+{
+    for (int i=0; i<RENDER_MAX_LANES; i++)
+    {
+        lanes[i].owner = this;
+        lanes[i].source = 0;
+        lanes[i].feed = 0;
+        lanes[i].frameBytes = 0;
+        lanes[i].rate = 0;
+        lanes[i].pos = 0;
+        lanes[i].len = 0;
+        lanes[i].want = 0;
+        lanes[i].cost = 0;
+        jobs[i] = nullptr;
+    }
+
+    nextJob = 0;
+    pending = 0;
+}
+
+ParallelRenderer::~ParallelRenderer()
+{
+    stop();
+}
+
+bool ParallelRenderer::start(int workers)
+{
+    if (running)
+        return true;
+
+    if (workers < 1)
+        return false;
+
+    if (workers > RENDER_MAX_WORKERS)
+        workers = RENDER_MAX_WORKERS;
+
+    quit = false;
+    generation = 0;
+    published = 0;
+    active = 0;
+
+    for (int i=0; i<workers; i++)
+        threads.push_back(std::thread(&ParallelRenderer::workerLoop, this));
+
+    running = true;
+
+    return true;
+}
+
+void ParallelRenderer::stop()
+{
+    if (!running)
+        return;
+
+    // feeds left attached would call into a dead pool
+    for (int i=0; i<RENDER_MAX_LANES; i++)
+    {
+        if (lanes[i].source != 0)
+            detach(lanes[i].source);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(workMutex);
+        quit = true;
+    }
+    workCond.notify_all();
+
+    for (std::thread &t : threads)
+        t.join();
+    threads.clear();
+
+    running = false;
+}
+
+HSTREAM ParallelRenderer::attach(HSTREAM source)
+{
+    if (!running || source == 0)
+        return 0;
+
+    HSTREAM f = feed(source);
+    if (f != 0)
+        return f;
+
+    BASS_CHANNELINFO info;
+    if (!BASS_ChannelGetInfo(source, &info))
+        return 0;
+
+    DWORD format = info.flags & (BASS_SAMPLE_FLOAT|BASS_SAMPLE_8BITS);
+    DWORD sampleBytes = 2;
+    if (format & BASS_SAMPLE_FLOAT)
+        sampleBytes = 4;
+    else if (format & BASS_SAMPLE_8BITS)
+        sampleBytes = 1;
+
+    Lane *lane = nullptr;
+
+    {
+        std::lock_guard<std::mutex> lock(laneMutex);
+
+        for (int i=0; i<RENDER_MAX_LANES; i++)
+        {
+            if (lanes[i].source == 0)
+            {
+                lane = &lanes[i];
+                break;
+            }
+        }
+
+        if (lane == nullptr)
+            return 0;
+
+        lane->source = source;
+        lane->feed = 0;
+        lane->frameBytes = info.chans * sampleBytes;
+        lane->rate = info.freq;
+        lane->buffer.assign(RENDER_PERIOD_FRAMES * lane->frameBytes, 0);
+        lane->pos = 0;
+        lane->len = 0;
+        lane->want = 0;
+        lane->cost = 0;
+    }
+
+    // not under the lock, a mixer thread may be waiting on it
+    f = BASS_StreamCreate(info.freq, info.chans, format|BASS_STREAM_DECODE, &feedProc, lane);
+
+    std::lock_guard<std::mutex> lock(laneMutex);
+
+    if (f == 0)
+    {
+        lane->source = 0;
+        std::vector<char>().swap(lane->buffer);
+        return 0;
+    }
+
+    lane->feed = f;
+
+    return f;
+}
+
+void ParallelRenderer::detach(HSTREAM source)
+{
+    if (source == 0)
+        return;
+
+    Lane *lane = nullptr;
+    HSTREAM f = 0;
+
+    {
+        std::lock_guard<std::mutex> lock(laneMutex);
+
+        for (int i=0; i<RENDER_MAX_LANES; i++)
+        {
+            if (lanes[i].source == source)
+            {
+                lane = &lanes[i];
+                break;
+            }
+        }
+
+        if (lane == nullptr)
+            return;
+
+        // out of the next periods
+        f = lane->feed;
+        lane->feed = 0;
+    }
+
+    // returns after a running feedProc of this stream
+    if (f != 0)
+        BASS_StreamFree(f);
+
+    std::lock_guard<std::mutex> lock(laneMutex);
+
+    lane->source = 0;
+    lane->pos = 0;
+    lane->len = 0;
+    lane->cost = 0;
+    std::vector<char>().swap(lane->buffer);
+}
+
+float ParallelRenderer::takeLoad()
+{
+    std::lock_guard<std::mutex> lock(loadMutex);
+
+    float load = 0;
+    if (loadAudioNs > 0)
+        load = static_cast<float>(loadWallNs / loadAudioNs * 100);
+
+    loadWallNs = 0;
+    loadAudioNs = 0;
+
+    return load;
+}
+
+HSTREAM ParallelRenderer::feed(HSTREAM source)
+{
+    // source and feed are only written by the thread that attaches
+    for (int i=0; i<RENDER_MAX_LANES; i++)
+    {
+        if (source != 0 && lanes[i].source == source)
+            return lanes[i].feed;
+    }
+
+    return 0;
+}
+
+DWORD CALLBACK ParallelRenderer::feedProc(HSTREAM handle, void *buffer, DWORD length, void *user)
+{
+    (void)handle;
+
+    Lane *lane = static_cast<Lane*>(user);
+    return lane->owner->read(lane, static_cast<char*>(buffer), length);
+}
+
+DWORD ParallelRenderer::read(Lane *lane, char *out, DWORD length)
+{
+    std::lock_guard<std::mutex> lock(laneMutex);
+
+    DWORD done = 0;
+
+    while (done < length)
+    {
+        DWORD avail = lane->len - lane->pos;
+
+        if (avail == 0)
+        {
+            DWORD frames = (length - done) / lane->frameBytes;
+            if (frames == 0)
+                break;
+            if (frames > RENDER_PERIOD_FRAMES)
+                frames = RENDER_PERIOD_FRAMES;
+
+            auto t0 = std::chrono::steady_clock::now();
+            runPeriod(frames);
+            auto t1 = std::chrono::steady_clock::now();
+
+            // wall time of the period against the audio it holds
+            if (lane->rate > 0)
+            {
+                std::lock_guard<std::mutex> loadLock(loadMutex);
+                loadWallNs += std::chrono::duration<double, std::nano>(t1 - t0).count();
+                loadAudioNs += frames * 1e9 / lane->rate;
+            }
+
+            avail = lane->len - lane->pos;
+            if (avail == 0)
+                break;
+        }
+
+        DWORD n = length - done;
+        if (n > avail)
+            n = avail;
+
+        std::memcpy(out + done, lane->buffer.data() + lane->pos, n);
+        lane->pos += n;
+        done += n;
+    }
+
+    return done;
+}
+
+void ParallelRenderer::runPeriod(DWORD frames)
+{
+    // top up every lane, the most expensive of the last period first
+    jobCount = 0;
+
+    for (int i=0; i<RENDER_MAX_LANES; i++)
+    {
+        Lane *lane = &lanes[i];
+        if (lane->feed == 0)
+            continue;
+
+        DWORD target = frames * lane->frameBytes;
+        DWORD avail = lane->len - lane->pos;
+        if (avail >= target)
+            continue;
+
+        if (lane->pos > 0)
+        {
+            std::memmove(lane->buffer.data(), lane->buffer.data() + lane->pos, avail);
+            lane->pos = 0;
+            lane->len = avail;
+        }
+
+        lane->want = target - avail;
+
+        int j = jobCount++;
+        while (j > 0 && jobs[j-1]->cost < lane->cost)
+        {
+            jobs[j] = jobs[j-1];
+            j--;
+        }
+        jobs[j] = lane;
+    }
+
+    if (jobCount == 0)
+        return;
+
+    if (threads.empty() || jobCount == 1)
+    {
+        for (int i=0; i<jobCount; i++)
+            renderLane(jobs[i]);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(workMutex);
+        nextJob = 0;
+        pending = jobCount;
+        published = jobCount;
+        generation++;
+    }
+    workCond.notify_all();
+
+    // the mixer thread takes its share too
+    workJobs(jobCount);
+
+    // a worker that wakes after this sees nothing published
+    std::unique_lock<std::mutex> lock(workMutex);
+    doneCond.wait(lock, [this] { return pending == 0 && active == 0; });
+    published = 0;
+}
+
+void ParallelRenderer::renderLane(Lane *lane)
+{
+    auto t0 = std::chrono::steady_clock::now();
+
+    char *dst = lane->buffer.data() + lane->len;
+    DWORD got = BASS_ChannelGetData(lane->source, dst, lane->want);
+    if (got == static_cast<DWORD>(-1))
+        got = 0;
+
+    // keep the period length, an ended or failed source is silence
+    if (got < lane->want)
+        std::memset(dst + got, 0, lane->want - got);
+
+    lane->len += lane->want;
+
+    auto t1 = std::chrono::steady_clock::now();
+    lane->cost = std::chrono::duration<double, std::nano>(t1 - t0).count();
+}
+
+void ParallelRenderer::workJobs(int count)
+{
+    for (;;)
+    {
+        int i = nextJob.fetch_add(1);
+        if (i >= count)
+            break;
+
+        renderLane(jobs[i]);
+
+        if (pending.fetch_sub(1) == 1)
+        {
+            std::lock_guard<std::mutex> lock(workMutex);
+            doneCond.notify_all();
+        }
+    }
+}
+
+void ParallelRenderer::workerLoop()
+{
+    unsigned int seen = 0;
+
+    for (;;)
+    {
+        int count = 0;
+
+        {
+            std::unique_lock<std::mutex> lock(workMutex);
+            workCond.wait(lock, [&] { return quit || generation != seen; });
+
+            if (quit)
+                return;
+
+            seen = generation;
+            count = published;
+            if (count == 0)
+                continue;
+
+            active++;
+        }
+
+        workJobs(count);
+
+        {
+            std::lock_guard<std::mutex> lock(workMutex);
+            active--;
+        }
+        doneCond.notify_all();
+    }
+}
@@ -0,0 +1,94 @@
+#ifndef PARALLELRENDERER_H
+#define PARALLELRENDERER_H
+
+#include <bass.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#define RENDER_MAX_LANES    64
+#define RENDER_MAX_WORKERS  15
+#define RENDER_PERIOD_FRAMES 4096
+
+// Decodes midi streams on a worker pool. Each attached source gets a
+// feed stream (custom STREAMPROC) that takes its place in the mixer
+// graph. When a feed runs dry a render period starts: every lane is
+// topped up to the requested length in parallel, the most expensive
+// lanes of the last period go first. Buffers are allocated on attach.
+class ParallelRenderer
+{
+public:
+    ParallelRenderer();
+    ~ParallelRenderer();
+
+    // workers besides the calling (mixer) thread
+    bool start(int workers);
+    void stop();
+    bool isRunning() { return running; }
+    int workerCount() { return static_cast<int>(threads.size()); }
+
+    // returns the feed stream to read instead of source, 0 on failure
+    HSTREAM attach(HSTREAM source);
+    // frees the feed, call before freeing the source
+    void detach(HSTREAM source);
+    HSTREAM feed(HSTREAM source);
+
+    // render time since the last call, in percent of the audio it
+    // rendered, over 100 the output runs dry
+    float takeLoad();
+
+    static DWORD CALLBACK feedProc(HSTREAM handle, void *buffer, DWORD length, void *user);
+
+private:
+    typedef struct
+    {
+        ParallelRenderer *owner;
+        HSTREAM source;
+        HSTREAM feed;
+        DWORD frameBytes;
+        DWORD rate;
+        std::vector<char> buffer;
+        DWORD pos;          // read offset
+        DWORD len;          // end of valid data
+        DWORD want;         // bytes to render this period
+        double cost;        // ns spent in the last period
+    } Lane;
+
+    DWORD read(Lane *lane, char *out, DWORD length);
+    void runPeriod(DWORD frames);
+    void renderLane(Lane *lane);
+    void workJobs(int count);
+    void workerLoop();
+
+    Lane lanes[RENDER_MAX_LANES];
+    Lane *jobs[RENDER_MAX_LANES];
+    int jobCount = 0;
+
+    // lanes and periods, held by the mixer thread for a whole period
+    std::mutex laneMutex;
+
+    // worker hand off
+    std::mutex workMutex;
+    std::condition_variable workCond;
+    std::condition_variable doneCond;
+    unsigned int generation = 0;
+    int published = 0;      // job count workers may take, 0 between periods
+    int active = 0;         // workers inside a period
+    bool quit = false;
+    std::atomic<int> nextJob;
+    std::atomic<int> pending;
+
+    // summed over the periods until takeLoad, a short period alone
+    // is mostly overhead
+    std::mutex loadMutex;
+    double loadWallNs = 0;
+    double loadAudioNs = 0;
+
+    std::vector<std::thread> threads;
+    bool running = false;
+};
+
+#endif // PARALLELRENDERER_H
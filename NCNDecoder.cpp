@@ -0,0 +1,122 @@
+#include "NCNDecoder.h"
+
+#include <array>
+
+
+namespace {
+
+std::array<ushort, 256> makeTIS620Table()
+{
+    std::array<ushort, 256> table;
+
+    // ascii and the C1 controls pass through like Qt's TIS-620 codec
+    for (int i=0; i<0xA1; i++)
+        table[i] = static_cast<ushort>(i);
+
+    // the thai block is in the order of the code page
+    for (int i=0xA1; i<0x100; i++)
+        table[i] = static_cast<ushort>(0x0E00 + i - 0xA0);
+
+    // not assigned in TIS-620
+    for (int i=0xDB; i<=0xDE; i++)
+        table[i] = 0xFFFD;
+    for (int i=0xFC; i<=0xFF; i++)
+        table[i] = 0xFFFD;
+
+    return table;
+}
+
+const std::array<ushort, 256> &tis620Table()
+{
+    static const std::array<ushort, 256> table = makeTIS620Table();
+    return table;
+}
+
+} // namespace
+
+QVector<long> NCNDecoder::cursorTicks(const QByteArray &cur, uint resolution)
+{
+    const int count = (cur.size() + 1) / 2;
+
+    QVector<long> ticks(count);
+    if (count == 0)
+        return ticks;
+
+    const uchar *data = reinterpret_cast<const uchar*>(cur.constData());
+
+    // whole pairs in one loop the compiler can vectorise, the odd byte after
+    const int pairs = cur.size() / 2;
+    cursorTicks(data, pairs, resolution, ticks.data());
+    if (pairs < count)
+        ticks[pairs] = static_cast<long>(data[pairs * 2] * resolution / 24);
+
+    return ticks;
+}
+
+void NCNDecoder::cursorTicks(const uchar *data, int count, uint resolution, long *ticks)
+{
+    for (int i=0; i<count; i++)
+    {
+        uint v = data[i * 2] | (data[i * 2 + 1] << 8);
+        ticks[i] = static_cast<long>(v * resolution / 24);
+    }
+}
+
+QString NCNDecoder::fromTIS620(const char *data, int size)
+{
+    if (size <= 0)
+        return QString("");
+
+    const std::array<ushort, 256> &table = tis620Table();
+    const uchar *in = reinterpret_cast<const uchar*>(data);
+
+    QString text(size, Qt::Uninitialized);
+    ushort *out = reinterpret_cast<ushort*>(text.data());
+
+    for (int i=0; i<size; i++)
+        out[i] = table[in[i]];
+
+    return text;
+}
+
+QStringList NCNDecoder::lyrLines(const QByteArray &lyr, int count)
+{
+    QStringList lines;
+
+    const char *data = lyr.constData();
+    const int size = lyr.size();
+
+    int pos = 0;
+    while (lines.count() < count && pos < size)
+    {
+        int end = lyr.indexOf('\n', pos);
+        int next = end < 0 ? size : end + 1;
+        if (end < 0)
+            end = size;
+
+        int length = end - pos;
+        if (end < size && length > 0 && data[end - 1] == '\r')
+            length--;
+
+        lines << fromTIS620(data + pos, length);
+        pos = next;
+    }
+
+    // QTextStream gives empty strings past the end
+    while (lines.count() < count)
+        lines << QString();
+
+    return lines;
+}
+
+QString NCNDecoder::lyrText(const QByteArray &lyr)
+{
+    int pos = 0;
+    for (int i=0; i<4 && pos < lyr.size(); i++)
+    {
+        int end = lyr.indexOf('\n', pos);
+        pos = end < 0 ? lyr.size() : end + 1;
+    }
+
+    return fromTIS620(lyr.constData() + pos, lyr.size() - pos);
+}
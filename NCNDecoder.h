@@ -0,0 +1,29 @@
+#ifndef NCNDECODER_H
+#define NCNDECODER_H
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// The NCN cursor and lyrics formats decoded straight from their bytes,
+// no QDataStream or QTextStream and no codec lookup. Any thread.
+class NCNDecoder
+{
+public:
+    // .cur: little-endian u16 positions in 1/24 of a beat -> midi ticks,
+    // an odd last byte is a position of its own like QDataStream read it
+    static QVector<long> cursorTicks(const QByteArray &cur, uint resolution);
+    static void cursorTicks(const uchar *data, int count, uint resolution, long *ticks);
+
+    static QString fromTIS620(const char *data, int size);
+    static QString fromTIS620(const QByteArray &data) { return fromTIS620(data.constData(), data.size()); }
+
+    // the first count lines like QTextStream::readLine gives them,
+    // a line ends at "\n" and a "\r\n" loses its "\r"
+    static QStringList lyrLines(const QByteArray &lyr, int count);
+    // everything after the four header lines (name, artist, key, type)
+    static QString lyrText(const QByteArray &lyr);
+};
+
+#endif // NCNDECODER_H
@@ -0,0 +1,393 @@
+#include "PrefixIndex.h"
+
+#include <QSqlQuery>
+
+#include <algorithm>
+
+
+// the texts compared for each field, in the order of its search
+static const int PARTS[3][3] = {
+    { 0, 1, 2 },    // id, name, artist
+    { 1, 2, 0 },    // name, artist, id
+    { 2, 1, 0 }     // artist, name, id
+};
+
+// rows loaded per "rowid IN" query
+static const int LOAD_CHUNK = 500;
+
+PrefixIndex::PrefixIndex()
+{
+}
+
+void PrefixIndex::clear()
+{
+    std::vector<ushort>().swap(arena);
+    std::vector<Entry>().swap(entries);
+    for (int f=0; f<3; f++)
+        std::vector<quint32>().swap(orders[f]);
+    std::vector<std::pair<qint64, quint32>>().swap(byRowid);
+
+    live = 0;
+    dead = 0;
+    built = false;
+}
+
+bool PrefixIndex::build(QSqlDatabase &db)
+{
+    clear();
+
+    std::vector<quint32> added;
+    if (!load(db, "", &added))
+        return false;
+
+    mergeNew(added);
+
+    arena.shrink_to_fit();
+    entries.shrink_to_fit();
+
+    built = true;
+
+    return true;
+}
+
+bool PrefixIndex::update(QSqlDatabase &db, const QList<qint64> &removed, const QList<qint64> &added)
+{
+    if (!built)
+        return build(db);
+
+    // a full scan is cheaper than many small queries
+    if (added.count() > live / 4)
+        return build(db);
+
+    for (qint64 rowid : removed)
+    {
+        int i = find(rowid);
+        if (i < 0)
+            continue;
+
+        entries[byRowid[i].second].flags |= Removed;
+        live--;
+        dead++;
+    }
+
+    auto isRemoved = [this](quint32 e) { return (entries[e].flags & Removed) != 0; };
+    for (int f=0; f<3; f++)
+        orders[f].erase(std::remove_if(orders[f].begin(), orders[f].end(), isRemoved), orders[f].end());
+    byRowid.erase(std::remove_if(byRowid.begin(), byRowid.end(),
+                                 [&](const std::pair<qint64, quint32> &r) { return isRemoved(r.second); }),
+                  byRowid.end());
+
+    // the rows as they are now, a row the index already has is not loaded twice
+    std::vector<quint32> loaded;
+    QStringList ids;
+
+    for (int i=0; i<added.count(); i++)
+    {
+        if (find(added[i]) < 0)
+            ids << QString::number(added[i]);
+
+        if (ids.count() == LOAD_CHUNK || (i == added.count() - 1 && !ids.isEmpty()))
+        {
+            if (!load(db, "WHERE rowid IN (" + ids.join(",") + ")", &loaded))
+                return false;
+            ids.clear();
+        }
+    }
+
+    mergeNew(loaded);
+
+    if (dead > live && dead > 1024)
+        compact();
+
+    return true;
+}
+
+void PrefixIndex::remove(qint64 rowid)
+{
+    int i = find(rowid);
+    if (i < 0)
+        return;
+
+    quint32 e = byRowid[i].second;
+    entries[e].flags |= Removed;
+    byRowid.erase(byRowid.begin() + i);
+
+    for (int f=0; f<3; f++)
+    {
+        std::vector<quint32>::iterator it = std::find(orders[f].begin(), orders[f].end(), e);
+        if (it != orders[f].end())
+            orders[f].erase(it);
+    }
+
+    live--;
+    dead++;
+}
+
+qint64 PrefixIndex::memoryUsage()
+{
+    qint64 bytes = static_cast<qint64>(arena.capacity()) * sizeof(ushort)
+                 + static_cast<qint64>(entries.capacity()) * sizeof(Entry)
+                 + static_cast<qint64>(byRowid.capacity()) * sizeof(std::pair<qint64, quint32>);
+
+    for (int f=0; f<3; f++)
+        bytes += static_cast<qint64>(orders[f].capacity()) * sizeof(quint32);
+
+    return bytes;
+}
+
+void PrefixIndex::range(PrefixField field, const QString &prefix, int *first, int *last)
+{
+    const int f = static_cast<int>(field);
+    const int part = PARTS[f][0];
+    const std::vector<quint32> &order = orders[f];
+
+    Key p = { prefix.utf16(), prefix.length() };
+
+    std::vector<quint32>::const_iterator lo = std::partition_point(order.begin(), order.end(),
+        [&](quint32 e) { return compare(key(e, part), p) < 0; });
+
+    // everything starting with the prefix sorts right after it
+    std::vector<quint32>::const_iterator hi = std::partition_point(lo, order.end(),
+        [&](quint32 e) {
+            Key k = key(e, part);
+            return k.length >= p.length && std::equal(p.text, p.text + p.length, k.text);
+        });
+
+    *first = static_cast<int>(lo - order.begin());
+    *last = static_cast<int>(hi - order.begin());
+}
+
+int PrefixIndex::seek(PrefixField field, const QVariantList &keys, bool forward)
+{
+    const int f = static_cast<int>(field);
+    const std::vector<quint32> &order = orders[f];
+
+    QString texts[3];
+    Key k[3];
+    for (int i=0; i<3; i++)
+    {
+        texts[i] = i < keys.count() ? keys[i].toString() : QString();
+        k[i].text = texts[i].utf16();
+        k[i].length = texts[i].length();
+    }
+    qint64 rowid = keys.count() > 3 ? keys[3].toLongLong() : 0;
+
+    std::vector<quint32>::const_iterator it;
+    if (forward)
+    {
+        it = std::partition_point(order.begin(), order.end(),
+            [&](quint32 e) { return compareTo(f, e, k, rowid) <= 0; });
+        return static_cast<int>(it - order.begin());
+    }
+
+    it = std::partition_point(order.begin(), order.end(),
+        [&](quint32 e) { return compareTo(f, e, k, rowid) < 0; });
+    return static_cast<int>(it - order.begin()) - 1;
+}
+
+bool PrefixIndex::isKar(PrefixField field, int pos)
+{
+    return (entries[orders[static_cast<int>(field)][pos]].flags & Kar) != 0;
+}
+
+qint64 PrefixIndex::rowid(PrefixField field, int pos)
+{
+    return entries[orders[static_cast<int>(field)][pos]].rowid;
+}
+
+QVariantList PrefixIndex::keys(PrefixField field, int pos)
+{
+    const int f = static_cast<int>(field);
+    quint32 e = orders[f][pos];
+
+    QVariantList list;
+    for (int i=0; i<3; i++)
+    {
+        Key k = key(e, PARTS[f][i]);
+        list << QString::fromUtf16(k.text, k.length);
+    }
+    list << entries[e].rowid;
+
+    return list;
+}
+
+quint32 PrefixIndex::add(qint64 rowid, const QVariant &id, const QVariant &name, const QVariant &artist, const QString &type)
+{
+    Entry e;
+    e.rowid = rowid;
+    e.flags = type == "KAR" ? Kar : 0;
+
+    const QVariant *texts[3] = { &id, &name, &artist };
+    for (int i=0; i<3; i++)
+    {
+        if (texts[i]->isNull())
+            e.flags |= NullId << i;
+        e.text[i] = store(texts[i]->toString(), &e.length[i]);
+    }
+
+    entries.push_back(e);
+    live++;
+
+    return static_cast<quint32>(entries.size() - 1);
+}
+
+quint32 PrefixIndex::store(const QString &s, quint16 *length)
+{
+    int n = qMin(s.length(), 0xFFFF);
+
+    quint32 offset = static_cast<quint32>(arena.size());
+    arena.insert(arena.end(), s.utf16(), s.utf16() + n);
+    *length = static_cast<quint16>(n);
+
+    return offset;
+}
+
+int PrefixIndex::find(qint64 rowid)
+{
+    std::vector<std::pair<qint64, quint32>>::iterator it = std::lower_bound(byRowid.begin(), byRowid.end(),
+        std::make_pair(rowid, quint32(0)));
+
+    if (it == byRowid.end() || it->first != rowid)
+        return -1;
+
+    return static_cast<int>(it - byRowid.begin());
+}
+
+void PrefixIndex::mergeNew(std::vector<quint32> &added)
+{
+    if (added.empty())
+        return;
+
+    for (int f=0; f<3; f++)
+    {
+        std::vector<quint32> fresh;
+        fresh.reserve(added.size());
+        for (quint32 e : added)
+        {
+            if (!(entries[e].flags & (NullId << PARTS[f][0])))
+                fresh.push_back(e);
+        }
+
+        std::sort(fresh.begin(), fresh.end(), [&](quint32 a, quint32 b) { return less(f, a, b); });
+
+        std::vector<quint32> &order = orders[f];
+        size_t mid = order.size();
+        order.insert(order.end(), fresh.begin(), fresh.end());
+        std::inplace_merge(order.begin(), order.begin() + mid, order.end(),
+                           [&](quint32 a, quint32 b) { return less(f, a, b); });
+    }
+
+    size_t mid = byRowid.size();
+    for (quint32 e : added)
+        byRowid.push_back(std::make_pair(entries[e].rowid, e));
+    std::sort(byRowid.begin() + mid, byRowid.end());
+    std::inplace_merge(byRowid.begin(), byRowid.begin() + mid, byRowid.end());
+}
+
+bool PrefixIndex::load(QSqlDatabase &db, const QString &where, std::vector<quint32> *added)
+{
+    QSqlQuery q(db);
+    q.setForwardOnly(true);
+
+    if (!q.exec("SELECT rowid, id_key, name_key, artist_key, songtype FROM songs " + where))
+        return false;
+
+    while (q.next())
+        added->push_back(add(q.value(0).toLongLong(), q.value(1), q.value(2), q.value(3), q.value(4).toString()));
+
+    q.finish();
+    q.clear();
+
+    return true;
+}
+
+void PrefixIndex::compact()
+{
+    // the live entries and their texts into new arrays, the orders stay sorted
+    std::vector<ushort> newArena;
+    std::vector<Entry> newEntries;
+    std::vector<quint32> moved(entries.size(), 0);
+
+    newArena.reserve(arena.size() - arena.size() * dead / (live + dead));
+    newEntries.reserve(live);
+
+    for (std::pair<qint64, quint32> &r : byRowid)
+    {
+        Entry e = entries[r.second];
+        for (int i=0; i<3; i++)
+        {
+            quint32 offset = static_cast<quint32>(newArena.size());
+            newArena.insert(newArena.end(), arena.begin() + e.text[i], arena.begin() + e.text[i] + e.length[i]);
+            e.text[i] = offset;
+        }
+
+        moved[r.second] = static_cast<quint32>(newEntries.size());
+        r.second = moved[r.second];
+        newEntries.push_back(e);
+    }
+
+    for (int f=0; f<3; f++)
+    {
+        for (quint32 &e : orders[f])
+            e = moved[e];
+    }
+
+    arena.swap(newArena);
+    entries.swap(newEntries);
+    dead = 0;
+}
+
+PrefixIndex::Key PrefixIndex::key(quint32 entry, int part)
+{
+    const Entry &e = entries[entry];
+    Key k = { arena.data() + e.text[part], e.length[part] };
+    return k;
+}
+
+bool PrefixIndex::less(int field, quint32 a, quint32 b)
+{
+    for (int i=0; i<3; i++)
+    {
+        int c = compare(key(a, PARTS[field][i]), key(b, PARTS[field][i]));
+        if (c != 0)
+            return c < 0;
+    }
+
+    return entries[a].rowid < entries[b].rowid;
+}
+
+int PrefixIndex::compareTo(int field, quint32 entry, const Key *keys, qint64 rowid)
+{
+    for (int i=0; i<3; i++)
+    {
+        int c = compare(key(entry, PARTS[field][i]), keys[i]);
+        if (c != 0)
+            return c;
+    }
+
+    qint64 r = entries[entry].rowid;
+    return r < rowid ? -1 : (r > rowid ? 1 : 0);
+}
+
+int PrefixIndex::compare(const Key &a, const Key &b)
+{
+    // code point order like sqlite's memcmp of utf-8,
+    // surrogates go above the rest of the BMP
+    int n = qMin(a.length, b.length);
+    for (int i=0; i<n; i++)
+    {
+        int x = a.text[i];
+        int y = b.text[i];
+        if (x == y)
+            continue;
+
+        if (x >= 0xD800 && y >= 0xD800)
+        {
+            x += x >= 0xE000 ? -0x800 : 0x2000;
+            y += y >= 0xE000 ? -0x800 : 0x2000;
+        }
+        return x < y ? -1 : 1;
+    }
+
+    return a.length - b.length;
+}
@@ -0,0 +1,95 @@
+#ifndef PREFIXINDEX_H
+#define PREFIXINDEX_H
+
+#include <QList>
+#include <QSqlDatabase>
+#include <QString>
+#include <QVariant>
+
+#include <vector>
+
+
+enum class PrefixField {
+    Id,
+    Name,
+    Artist
+};
+
+// The songs id, name and artist keys in memory, each field sorted in
+// the order of its search (name: name, artist, id, rowid). The keys are
+// stored once in a UTF-16 arena, a prefix range and its neighbours are
+// binary searches with no sql.
+class PrefixIndex
+{
+public:
+    PrefixIndex();
+
+    bool isBuilt() { return built; }
+    void clear();
+
+    bool build(QSqlDatabase &db);
+    // the rows a rescan deleted and inserted
+    bool update(QSqlDatabase &db, const QList<qint64> &removed, const QList<qint64> &added);
+    void remove(qint64 rowid);
+
+    int count() { return live; }
+    qint64 memoryUsage();
+
+    // positions in the order of field, last is one past the end,
+    // prefix is a SongDatabase::searchKey
+    void range(PrefixField field, const QString &prefix, int *first, int *last);
+    // the first position after (forward) or the last before the keys
+    // of a search row: the three texts of the field order and the rowid
+    int seek(PrefixField field, const QVariantList &keys, bool forward);
+
+    bool isKar(PrefixField field, int pos);
+    qint64 rowid(PrefixField field, int pos);
+    // the search row keys of a position, like seek takes them
+    QVariantList keys(PrefixField field, int pos);
+
+private:
+    typedef struct
+    {
+        quint32 text[3];    // arena offsets of id, name, artist
+        quint16 length[3];
+        quint8 flags;
+        qint64 rowid;
+    } Entry;
+
+    enum {
+        Kar = 0x01,
+        Removed = 0x02,
+        NullId = 0x04      // NullId << field, a null is not in that order
+    };
+
+    typedef struct
+    {
+        const ushort *text;
+        int length;
+    } Key;
+
+    quint32 add(qint64 rowid, const QVariant &id, const QVariant &name, const QVariant &artist, const QString &type);
+    quint32 store(const QString &s, quint16 *length);
+    int find(qint64 rowid);
+    void mergeNew(std::vector<quint32> &added);
+    bool load(QSqlDatabase &db, const QString &where, std::vector<quint32> *added);
+    void compact();
+
+    Key key(quint32 entry, int part);
+    bool less(int field, quint32 a, quint32 b);
+    int compareTo(int field, quint32 entry, const Key *keys, qint64 rowid);
+
+    static int compare(const Key &a, const Key &b);
+
+    std::vector<ushort> arena;
+    std::vector<Entry> entries;
+    std::vector<quint32> orders[3];
+    // (rowid, entry) sorted by rowid
+    std::vector<std::pair<qint64, quint32>> byRowid;
+
+    int live = 0;
+    int dead = 0;
+    bool built = false;
+};
+
+#endif // PREFIXINDEX_H
@@ -0,0 +1,538 @@
+#include "SearchWorker.h"
+
+#include "SongDatabase.h"
+
+#include <QLibrary>
+#include <QSqlDriver>
+#include <QSqlQuery>
+
+#include <algorithm>
+
+
+typedef void (*InterruptFunc)(void *);
+typedef const char* (*VersionFunc)();
+
+// Qt does not expose sqlite3_interrupt. It can be reached when the driver
+// uses a shared sqlite, a copy built in to the plugin does not export it.
+// A library of another version could lay out the handle differently.
+static InterruptFunc resolveInterrupt(const QString &version)
+{
+    const char *names[] = { "sqlite3", "libsqlite3" };
+
+    for (const char *name : names) {
+        QLibrary lib(name, 0);
+        if (!lib.load()) {
+            lib.setFileName(name);
+            if (!lib.load())
+                continue;
+        }
+
+        VersionFunc libVersion = reinterpret_cast<VersionFunc>(lib.resolve("sqlite3_libversion"));
+        InterruptFunc f = reinterpret_cast<InterruptFunc>(lib.resolve("sqlite3_interrupt"));
+
+        if (f != nullptr && libVersion != nullptr && version == libVersion())
+            return f;
+    }
+
+    return nullptr;
+}
+
+SearchWorker::SearchWorker(const QString &dbPath)
+{
+    this->dbPath = dbPath;
+    connectionName = "search";
+    latest = 0;
+}
+
+SearchWorker::~SearchWorker()
+{
+    if (db.isValid()) {
+        {
+            std::lock_guard<std::mutex> lock(runMutex);
+            handle = nullptr;
+        }
+        db.close();
+        db = QSqlDatabase();
+        QSqlDatabase::removeDatabase(connectionName);
+    }
+}
+
+void SearchWorker::setGeneration(int gen)
+{
+    latest = gen;
+
+    // the result of the running query would be dropped anyway
+    std::lock_guard<std::mutex> lock(runMutex);
+    if (runningGen >= 0 && runningGen != gen && handle != nullptr && interrupt != nullptr)
+        interrupt(handle);
+}
+
+bool SearchWorker::open()
+{
+    if (db.isOpen())
+        return true;
+
+    // a connection belongs to the thread that opened it
+    if (!db.isValid()) {
+        db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+        db.setDatabaseName(dbPath);
+    }
+
+    if (!db.open())
+        return false;
+
+    QSqlQuery q(db);
+    q.exec("PRAGMA cache_size = -16384");
+    q.exec("PRAGMA temp_store = MEMORY");
+
+    QString version;
+    if (q.exec("SELECT sqlite_version()") && q.next())
+        version = q.value(0).toString();
+    q.finish();
+    q.clear();
+
+    QVariant v = db.driver()->handle();
+    if (v.isValid() && qstrcmp(v.typeName(), "sqlite3*") == 0) {
+        std::lock_guard<std::mutex> lock(runMutex);
+        handle = *static_cast<void **>(v.data());
+        interrupt = resolveInterrupt(version);
+    }
+
+    reloadIndex();
+
+    return true;
+}
+
+void SearchWorker::search(int gen, const QString &text, SearchType type, bool useFts)
+{
+    this->gen = gen;
+    if (isStale())
+        return;
+
+    if (!open()) {
+        emit notFound(gen);
+        return;
+    }
+
+    searchText = text;
+    textKey = SongDatabase::searchKey(text);
+    if (textKey.isNull())
+        textKey = "";
+    searchType = type;
+    this->useFts = useFts;
+
+    blocks = searchBlocks();
+    window = fetchForward(nullptr, SEARCH_WINDOW);
+    windowPos = window.isEmpty() ? -1 : 0;
+
+    if (isStale())
+        return;
+
+    if (windowPos == 0)
+        emit found(gen, window[0].song);
+    else
+        emit notFound(gen);
+}
+
+void SearchWorker::searchNext(int gen)
+{
+    this->gen = gen;
+    if (isStale() || window.isEmpty())
+        return;
+
+    int i = windowPos + 1;
+
+    for (;;) {
+        while (i < window.count() && window[i].removed)
+            i++;
+
+        if (i < window.count())
+            break;
+
+        QList<SearchRow> rows = fetchForward(&window.last(), SEARCH_WINDOW);
+        if (rows.isEmpty() || isStale())
+            return;
+
+        window.append(rows);
+
+        // keep a few pages around the current row
+        int drop = window.count() - SEARCH_WINDOW * 3;
+        if (drop > 0) {
+            window.erase(window.begin(), window.begin() + drop);
+            windowPos -= drop;
+            i -= drop;
+        }
+    }
+
+    windowPos = i;
+    emit found(gen, window[i].song);
+}
+
+void SearchWorker::searchPrevious(int gen)
+{
+    this->gen = gen;
+    if (isStale() || window.isEmpty())
+        return;
+
+    int i = windowPos - 1;
+
+    for (;;) {
+        while (i >= 0 && window[i].removed)
+            i--;
+
+        if (i >= 0)
+            break;
+
+        QList<SearchRow> rows = fetchBackward(&window.first(), SEARCH_WINDOW);
+        if (rows.isEmpty() || isStale())
+            return;
+
+        int added = rows.count();
+        rows.append(window);
+        window = rows;
+        windowPos += added;
+        i += added;
+
+        int drop = window.count() - SEARCH_WINDOW * 3;
+        if (drop > 0)
+            window.erase(window.end() - drop, window.end());
+    }
+
+    windowPos = i;
+    emit found(gen, window[i].song);
+}
+
+void SearchWorker::markRemoved(int gen, const SongRecord &song)
+{
+    if (gen != latest)
+        return;
+
+    // the next searchNext goes to the row after it
+    for (SearchRow &r : window) {
+        if (r.song.id == song.id && r.song.name == song.name
+                && r.song.type == song.type && r.song.path == song.path) {
+            r.removed = true;
+            prefixIndex.remove(r.keys.last().toLongLong());
+        }
+    }
+}
+
+void SearchWorker::updateIndex(const QList<qint64> &removed, const QList<qint64> &added)
+{
+    if (!db.isOpen())
+        return;
+
+    if (!prefixIndex.update(db, removed, added))
+        prefixIndex.clear();
+
+    emit indexChanged(prefixIndex.memoryUsage());
+}
+
+void SearchWorker::reloadIndex()
+{
+    // queued at startup, opening builds the index
+    if (!db.isOpen()) {
+        open();
+        return;
+    }
+
+    if (!prefixIndex.build(db))
+        prefixIndex.clear();
+
+    emit indexChanged(prefixIndex.memoryUsage());
+}
+
+QList<SearchBlock> SearchWorker::searchBlocks()
+{
+    const QString columns = "s.id, s.name, s.artist, s.keyname, s.tempo, s.songtype, s.lyrics, s.path";
+
+    // key >= prefix AND key < prefix + U+10FFFF, a range scan of the key index
+    const QString upper = textKey + QChar(0xDBFF) + QChar(0xDFFF);
+    const QVariantList range = QVariantList() << textKey << upper;
+
+    const QStringList byId = QStringList() << "s.id_key" << "s.name_key" << "s.artist_key";
+    const QStringList byName = QStringList() << "s.name_key" << "s.artist_key" << "s.id_key";
+    const QStringList byArtist = QStringList() << "s.artist_key" << "s.name_key" << "s.id_key";
+
+    QList<SearchBlock> list;
+    SearchBlock b;
+    b.columns = columns;
+    b.from = "songs s";
+    b.binds = range;
+
+    // the prefix blocks come from memory when the index is built
+    b.indexed = prefixIndex.isBuilt();
+    b.skipKar = false;
+
+    switch (searchType) {
+    case SearchType::ByAll:
+        b.where = "s.id_key >= ? AND s.id_key < ? AND s.songtype != 'KAR'";
+        b.keys = byId;
+        b.field = PrefixField::Id;
+        b.skipKar = true;
+        list.append(b);
+
+        b.where = "s.name_key >= ? AND s.name_key < ? AND s.songtype != 'KAR'";
+        b.keys = byName;
+        b.field = PrefixField::Name;
+        list.append(b);
+
+        b.where = "s.artist_key >= ? AND s.artist_key < ? AND s.songtype != 'KAR'";
+        b.keys = byArtist;
+        b.field = PrefixField::Artist;
+        list.append(b);
+
+        b.indexed = false;
+
+        // trigrams need 3 characters, shorter text only looks in the kar names
+        if (useFts && searchText.length() >= 3) {
+            // one quoted phrase, any substring of name, artist or lyrics
+            QString phrase = searchText;
+            phrase.replace("\"", "\"\"");
+
+            b.columns = "s.id, s.name, s.artist, s.keyname, s.tempo, s.songtype, "
+                        "snippet(songs_fts, 2, '', '', '...', 64), s.path";
+            b.from = "songs_fts JOIN songs s ON s.rowid = songs_fts.rowid";
+            b.where = "songs_fts MATCH ? "
+                      "AND NOT (s.songtype != 'KAR' AND ("
+                          "(s.id_key >= ? AND s.id_key < ?) OR "
+                          "(s.name_key >= ? AND s.name_key < ?) OR "
+                          "(s.artist_key >= ? AND s.artist_key < ?)))";
+            b.binds = QVariantList() << "\"" + phrase + "\"" << range << range << range;
+            b.keys = QStringList() << "bm25(songs_fts, 10.0, 5.0, 1.0)" << byName;
+        } else {
+            b.where = "instr(s.name_key, ?) > 0 AND s.songtype = 'KAR'";
+            b.binds = QVariantList() << textKey;
+            b.keys = byName;
+        }
+        list.append(b);
+        break;
+    case SearchType::ById:
+        b.where = "s.id_key >= ? AND s.id_key < ?";
+        b.keys = byId;
+        b.field = PrefixField::Id;
+        list.append(b);
+        break;
+    case SearchType::ByName:
+        b.where = "s.name_key >= ? AND s.name_key < ?";
+        b.keys = byName;
+        b.field = PrefixField::Name;
+        list.append(b);
+        break;
+    case SearchType::ByArtist:
+        b.where = "s.artist_key >= ? AND s.artist_key < ?";
+        b.keys = byArtist;
+        b.field = PrefixField::Artist;
+        list.append(b);
+        break;
+    }
+
+    return list;
+}
+
+QList<SearchRow> SearchWorker::fetchRows(int block, const SearchRow *from, bool forward, int limit)
+{
+    QList<SearchRow> rows;
+
+    if (block < 0 || block >= blocks.count() || limit <= 0)
+        return rows;
+
+    const SearchBlock &b = blocks[block];
+
+    if (b.indexed)
+        return fetchIndexed(block, from, forward, limit);
+
+    // (k0, k1, .., rowid) > (?, ?, .., ?) walks the sort index from the last row
+    QStringList keys = b.keys;
+    keys << "s.rowid";
+
+    QStringList aliases;
+    QStringList order;
+    QString inner = "SELECT " + b.columns;
+    for (int i=0; i<keys.count(); i++) {
+        QString k = "k" + QString::number(i);
+        inner += ", " + keys[i] + " AS " + k;
+        aliases << k;
+        order << (forward ? k : k + " DESC");
+    }
+    inner += " FROM " + b.from + " WHERE " + b.where;
+
+    QString sql = "SELECT * FROM (" + inner + ")";
+    if (from != nullptr) {
+        QStringList marks;
+        for (int i=0; i<keys.count(); i++)
+            marks << "?";
+        sql += " WHERE (" + aliases.join(", ") + ") " + (forward ? ">" : "<")
+             + " (" + marks.join(", ") + ")";
+    }
+    sql += " ORDER BY " + order.join(", ") + " LIMIT ?";
+
+    QSqlQuery q(db);
+    q.setForwardOnly(true);
+    q.prepare(sql);
+
+    int n = 0;
+    for (const QVariant &v : b.binds)
+        q.bindValue(n++, v);
+    if (from != nullptr) {
+        for (const QVariant &v : from->keys)
+            q.bindValue(n++, v);
+    }
+    q.bindValue(n, limit);
+
+    {
+        std::lock_guard<std::mutex> lock(runMutex);
+        runningGen = gen;
+    }
+
+    // an interrupted query ends like an empty one, without the
+    // interrupt the rows of a stale search stop here
+    if (!isStale() && q.exec()) {
+        while (q.next() && !isStale()) {
+            SearchRow r;
+            r.block = block;
+            r.removed = false;
+
+            r.song.id = q.value(0).toString();
+            r.song.name = q.value(1).toString();
+            r.song.artist = q.value(2).toString();
+            r.song.key = q.value(3).toString();
+            r.song.tempo = q.value(4).toInt();
+            r.song.type = q.value(5).toString();
+            r.song.lyrics = q.value(6).toString();
+            r.song.path = q.value(7).toString();
+
+            for (int i=0; i<keys.count(); i++)
+                r.keys << q.value(8 + i);
+
+            rows.append(r);
+        }
+    }
+    q.finish();
+    q.clear();
+
+    {
+        std::lock_guard<std::mutex> lock(runMutex);
+        runningGen = -1;
+    }
+
+    return rows;
+}
+
+QList<SearchRow> SearchWorker::fetchIndexed(int block, const SearchRow *from, bool forward, int limit)
+{
+    QList<SearchRow> rows;
+
+    const SearchBlock &b = blocks[block];
+
+    int first, last;
+    prefixIndex.range(b.field, textKey, &first, &last);
+
+    int pos;
+    if (from == nullptr) {
+        pos = forward ? first : last - 1;
+    } else {
+        pos = prefixIndex.seek(b.field, from->keys, forward);
+        pos = forward ? qMax(pos, first) : qMin(pos, last - 1);
+    }
+
+    const int step = forward ? 1 : -1;
+    QList<qint64> gone;
+
+    // the order is in memory, the texts of the page are read by rowid
+    while (rows.count() < limit && pos >= first && pos < last && !isStale()) {
+        QList<qint64> ids;
+        QList<QVariantList> keys;
+        QStringList marks;
+
+        for (; ids.count() < limit - rows.count() && pos >= first && pos < last; pos += step) {
+            if (b.skipKar && prefixIndex.isKar(b.field, pos))
+                continue;
+            ids << prefixIndex.rowid(b.field, pos);
+            keys << prefixIndex.keys(b.field, pos);
+            marks << QString::number(ids.last());
+        }
+
+        if (ids.isEmpty())
+            break;
+
+        QSqlQuery q(db);
+        q.setForwardOnly(true);
+
+        QHash<qint64, SongRecord> found;
+        if (q.exec("SELECT " + b.columns + ", s.rowid FROM songs s WHERE s.rowid IN (" + marks.join(",") + ")")) {
+            while (q.next()) {
+                SongRecord song;
+                song.id = q.value(0).toString();
+                song.name = q.value(1).toString();
+                song.artist = q.value(2).toString();
+                song.key = q.value(3).toString();
+                song.tempo = q.value(4).toInt();
+                song.type = q.value(5).toString();
+                song.lyrics = q.value(6).toString();
+                song.path = q.value(7).toString();
+                found.insert(q.value(8).toLongLong(), song);
+            }
+        }
+        q.finish();
+        q.clear();
+
+        for (int i=0; i<ids.count(); i++) {
+            // deleted since the index was updated
+            if (!found.contains(ids[i])) {
+                gone << ids[i];
+                continue;
+            }
+
+            SearchRow r;
+            r.block = block;
+            r.removed = false;
+            r.keys = keys[i];
+            r.song = found.value(ids[i]);
+            rows.append(r);
+        }
+    }
+
+    // the positions are not used any more
+    for (qint64 rowid : gone)
+        prefixIndex.remove(rowid);
+
+    return rows;
+}
+
+QList<SearchRow> SearchWorker::fetchForward(const SearchRow *after, int limit)
+{
+    QList<SearchRow> rows;
+
+    int block = after != nullptr ? after->block : 0;
+
+    // the rest of this block, then the next blocks from their start
+    while (rows.count() < limit && block < blocks.count() && !isStale()) {
+        rows.append(fetchRows(block, after, true, limit - rows.count()));
+        after = nullptr;
+        block++;
+    }
+
+    return rows;
+}
+
+QList<SearchRow> SearchWorker::fetchBackward(const SearchRow *before, int limit)
+{
+    QList<SearchRow> rows;
+
+    if (before == nullptr)
+        return rows;
+
+    int block = before->block;
+
+    while (rows.count() < limit && block >= 0 && !isStale()) {
+        rows.append(fetchRows(block, before, false, limit - rows.count()));
+        before = nullptr;
+        block--;
+    }
+
+    // fetched nearest first
+    std::reverse(rows.begin(), rows.end());
+
+    return rows;
+}
@@ -0,0 +1,113 @@
+#ifndef SEARCHWORKER_H
+#define SEARCHWORKER_H
+
+#include "LibraryIndexer.h"
+#include "PrefixIndex.h"
+
+#include <QList>
+#include <QObject>
+#include <QSqlDatabase>
+#include <QVariant>
+
+#include <atomic>
+#include <mutex>
+
+
+enum class SearchType {
+    ByAll,
+    ById,
+    ByName,
+    ByArtist
+};
+
+// one ordered part of a search, ByAll has four
+typedef struct
+{
+    QString columns;        // the songs columns in table order
+    QString from;
+    QString where;
+    QVariantList binds;
+    QStringList keys;       // order by, the rowid is added last
+    bool indexed;           // a prefix of field, read from the PrefixIndex
+    PrefixField field;
+    bool skipKar;
+} SearchBlock;
+
+// a search result and its place in the ordering
+typedef struct
+{
+    int block;
+    QVariantList keys;
+    SongRecord song;
+    bool removed;
+} SearchRow;
+
+// Runs the searches on its own thread with its own connection.
+// Every search has a generation, setting a newer one interrupts the
+// running query and the requests queued before it are skipped.
+class SearchWorker : public QObject
+{
+    Q_OBJECT
+public:
+    SearchWorker(const QString &dbPath);
+    ~SearchWorker();
+
+    // any thread
+    void setGeneration(int gen);
+
+public slots:
+    void search(int gen, const QString &text, SearchType type, bool useFts);
+    void searchNext(int gen);
+    void searchPrevious(int gen);
+    void markRemoved(int gen, const SongRecord &song);
+
+    // after a rescan, reload when the rowids changed
+    void updateIndex(const QList<qint64> &removed, const QList<qint64> &added);
+    void reloadIndex();
+
+signals:
+    void found(int gen, const SongRecord &song);
+    void notFound(int gen);
+    void indexChanged(qint64 bytes);
+
+private:
+    bool open();
+    bool isStale() { return gen != latest; }
+
+    // keyset paging, a window of rows around the current one
+    QList<SearchBlock> searchBlocks();
+    QList<SearchRow> fetchRows(int block, const SearchRow *from, bool forward, int limit);
+    QList<SearchRow> fetchIndexed(int block, const SearchRow *from, bool forward, int limit);
+    QList<SearchRow> fetchForward(const SearchRow *after, int limit);
+    QList<SearchRow> fetchBackward(const SearchRow *before, int limit);
+
+private:
+    QSqlDatabase db;
+    QString dbPath;
+    QString connectionName;
+
+    SearchType searchType = SearchType::ByAll;
+    QString searchText = "";
+    QString textKey = "";       // SongDatabase::searchKey of the text
+    bool useFts = false;
+
+    PrefixIndex prefixIndex;
+
+    QList<SearchBlock> blocks;
+    QList<SearchRow> window;
+    int windowPos = -1;
+
+    // the request being run and the newest search
+    int gen = 0;
+    std::atomic<int> latest;
+
+    // sqlite3_interrupt of the connection, null when it can't be reached
+    std::mutex runMutex;
+    void (*interrupt)(void *) = nullptr;
+    void *handle = nullptr;
+    int runningGen = -1;
+
+    const int SEARCH_WINDOW = 32;
+};
+
+#endif // SEARCHWORKER_H
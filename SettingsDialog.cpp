@@ -16,6 +16,18 @@
 #include "Dialogs/Chorus2Dialog.h"
 #include "Dialogs/Reverb2Dialog.h"
 
+static QString countSongsText(SongDatabase *db)
+{
+    QString text = QString::number(db->count()) + " เพลง";
+
+    // the search worker's in-memory index, 0 until it is built
+    qint64 bytes = db->searchIndexMemory();
+    if (bytes > 0)
+        text += " (ดัชนีค้นหา " + QString::number(bytes / 1048576.0, 'f', 1) + " MB)";
+
+    return text;
+}
+
 SettingsDialog::SettingsDialog(QWidget *parent, MainWindow *m) :
     QDialog(parent),
     ui(new Ui::SettingsDialog)
@@ -156,9 +168,10 @@ SettingsDialog::SettingsDialog(QWidget *parent, MainWindow *m) :
     ui->leNCNPath->setText(db->ncnPath());
     ui->leHNKPath->setText(db->hnkPath());
     ui->leKARPath->setText(db->karPath());
-    ui->lbCountSongsValue->setText(QString::number(db->count()) + " เพลง");
+    ui->lbCountSongsValue->setText(countSongsText(db));
 
-    if (db->isRunning())
+    // the watcher's small updates leave the button alone
+    if (db->isFullUpdating())
     {
         ui->barUpdateSongs->setMaximum(db->updateCount());
         ui->btnUpdateSongs->setEnabled(false);
@@ -332,6 +345,10 @@ void SettingsDialog::initDeviceTab()
     MidiSynthesizer *synth = player->midiSynthesizer();
     ui->chbSynthFloat->setChecked(synth->isUseFloattingPoint());
     ui->chbSynthFx->setChecked(synth->isUseFXRC());
+    ui->chbSynthGovernor->setChecked(synth->isUseGovernor());
+    ui->chbSynthParallel->setChecked(synth->isUseParallelRender());
+    ui->spinCpuCeiling->setValue(synth->cpuCeiling());
+    ui->spinCpuCeiling->setEnabled(synth->isUseGovernor());
     ui->sliderBuffer->setValue(BASS_GetConfig(BASS_CONFIG_BUFFER));
 
     connect(ui->chbLockDrum, SIGNAL(toggled(bool)), this, SLOT(onChbLockDrumToggled(bool)));
@@ -340,6 +357,9 @@ void SettingsDialog::initDeviceTab()
 
     connect(ui->chbSynthFloat, SIGNAL(toggled(bool)), this, SLOT(onChbFloatPointToggled(bool)));
     connect(ui->chbSynthFx, SIGNAL(toggled(bool)), this, SLOT(onChbUseFXToggled(bool)));
+    connect(ui->chbSynthGovernor, SIGNAL(toggled(bool)), this, SLOT(onChbGovernorToggled(bool)));
+    connect(ui->chbSynthParallel, SIGNAL(toggled(bool)), this, SLOT(onChbParallelRenderToggled(bool)));
+    connect(ui->spinCpuCeiling, SIGNAL(valueChanged(int)), this, SLOT(onSpinCpuCeilingValueChanged(int)));
     connect(ui->sliderBuffer, SIGNAL(valueChanged(int)), this, SLOT(onSliderBufferValueChanged(int)));
 }
 
@@ -528,12 +548,15 @@ void SettingsDialog::on_btnUpdateSongs_clicked()
     ui->lbCountSongsText->setEnabled(false);
     ui->lbCountSongsValue->setEnabled(false);
 
-    db->setUpdateType(UpdateType::UpdateAll);
-    db->start();
+    db->requestUpdate(UpdateType::UpdateAll);
 }
 
 void SettingsDialog::on_upDbUpdateFinished()
 { 
+    // a watcher's run finished, the full update queued behind it starts now
+    if (db->isFullUpdating())
+        return;
+
     ui->btnHNKPath->setEnabled(true);
     ui->btnNCNPath->setEnabled(true);
     ui->btnKARPath->setEnabled(true);
@@ -542,7 +565,7 @@ void SettingsDialog::on_upDbUpdateFinished()
     ui->lbUpdateText->hide();
     ui->lbUpdateValue->hide();
     ui->btnUpdateSongs->setEnabled(true);
-    ui->lbCountSongsValue->setText(QString::number(db->count()) + " เพลง");
+    ui->lbCountSongsValue->setText(countSongsText(db));
 }
 
 void SettingsDialog::on_btnMapChannel_clicked()
@@ -685,6 +708,28 @@ void SettingsDialog::onChbUseFXToggled(bool checked)
     settings->setValue("SynthUseFXRC", checked);
 }
 
+void SettingsDialog::onChbGovernorToggled(bool checked)
+{
+    mainWin->midiPlayer()->midiSynthesizer()->setUseGovernor(checked);
+    ui->spinCpuCeiling->setEnabled(checked);
+    settings->setValue("SynthGovernor", checked);
+}
+
+void SettingsDialog::onChbParallelRenderToggled(bool checked)
+{
+    if (mainWin->midiPlayer()->midiOutPortNumber() == -1)
+        mainWin->stop();
+
+    mainWin->midiPlayer()->midiSynthesizer()->setUseParallelRender(checked);
+    settings->setValue("SynthParallelRender", checked);
+}
+
+void SettingsDialog::onSpinCpuCeilingValueChanged(int value)
+{
+    mainWin->midiPlayer()->midiSynthesizer()->setCpuCeiling(value);
+    settings->setValue("SynthCpuCeiling", value);
+}
+
 void SettingsDialog::onSliderBufferValueChanged(int value)
 {
     MidiSynthesizer *synth = mainWin->midiPlayer()->midiSynthesizer();
@@ -59,6 +59,9 @@ private slots:
 
     void onChbFloatPointToggled(bool checked);
     void onChbUseFXToggled(bool checked);
+    void onChbGovernorToggled(bool checked);
+    void onChbParallelRenderToggled(bool checked);
+    void onSpinCpuCeilingValueChanged(int value);
     void onSliderBufferValueChanged(int value);
 
 
@@ -1,12 +1,17 @@
 #include "SongDatabase.h"
 
+#include "CompanionResolver.h"
+#include "NCNDecoder.h"
 #include "Midi/MidiFile.h"
 #include "Midi/HNKFile.h"
+#include "Midi/MidiAnalyzer.h"
 #include "Config.h"
 
+#include <QDateTime>
 #include <QDir>
-#include <QDirIterator>
+#include <QElapsedTimer>
 #include <QFile>
+#include <QFileInfo>
 #include <QSqlQuery>
 #include <QTextStream>
 
@@ -58,17 +63,54 @@ SongDatabase::SongDatabase()
             query.exec(sql);
             query.finish();
             query.clear();
-
-            createIndex();
         }
+
+        createKeyColumns();
+        createAnalysisColumns();
+        createIndex();
+        createFilesTable(db);
+        createSearchIndex();
+
         db.close();
     }
 
-    db.open();
+    if (db.open()) {
+        setPragmas(db);
+    }
+
+    // typing does not wait for sqlite, the worker opens its own connection
+    searcher = new SearchWorker(DATABASE_FILE_PATH);
+    searcher->moveToThread(&searchThread);
+
+    connect(&searchThread, SIGNAL(finished()), searcher, SLOT(deleteLater()));
+    connect(this, SIGNAL(searchRequested(int,QString,SearchType,bool)), searcher, SLOT(search(int,QString,SearchType,bool)));
+    connect(this, SIGNAL(searchNextRequested(int)), searcher, SLOT(searchNext(int)));
+    connect(this, SIGNAL(searchPreviousRequested(int)), searcher, SLOT(searchPrevious(int)));
+    connect(this, SIGNAL(removeRequested(int,SongRecord)), searcher, SLOT(markRemoved(int,SongRecord)));
+    connect(searcher, SIGNAL(found(int,SongRecord)), this, SLOT(onSearchFound(int,SongRecord)));
+    connect(searcher, SIGNAL(notFound(int)), this, SLOT(onSearchNotFound(int)));
+    connect(this, SIGNAL(songsChanged(QList<qint64>,QList<qint64>)), searcher, SLOT(updateIndex(QList<qint64>,QList<qint64>)));
+    connect(this, SIGNAL(songsReset()), searcher, SLOT(reloadIndex()));
+    connect(searcher, SIGNAL(indexChanged(qint64)), this, SLOT(onSearchIndexChanged(qint64)));
+
+    searchThread.start();
+
+    // the prefix index is ready before the first keystroke
+    QMetaObject::invokeMethod(searcher, "reloadIndex", Qt::QueuedConnection);
+
+    watcher = new LibraryWatcher(this);
+
+    connect(watcher, SIGNAL(directoriesChanged(QStringList)), this, SLOT(onLibraryChanged(QStringList)));
+    connect(this, SIGNAL(directoriesUnsettled(QStringList)), watcher, SLOT(markChanged(QStringList)));
+    connect(this, SIGNAL(finished()), this, SLOT(onUpdateFinished()));
 }
 
 SongDatabase::~SongDatabase()
 {
+    searcher->setGeneration(-1);
+    searchThread.quit();
+    searchThread.wait();
+
     if (db.isOpen()) {
         db.close();
     }
@@ -108,6 +150,17 @@ void SongDatabase::updateToNewVersion()
     q.exec("vacuum");
     q.finish();
     q.clear();
+
+    // songs was recreated and vacuum can renumber the rowids
+    createKeyColumns();
+    createAnalysisColumns();
+    createIndex();
+    createSearchIndex();
+    rebuildSearchIndex();
+
+    emit songsReset();
+
+    checkReindex();
 }
 
 int SongDatabase::count()
@@ -141,69 +194,113 @@ bool SongDatabase::isNCNPath(const QString &dir)
     }
 }
 
-QString SongDatabase::getCurFilePath(const QString &midFilePath)
+bool SongDatabase::setNcnPath(const QString &dir)
 {
-    QString cur = midFilePath;
+    if (isNCNPath(dir)) {
+        _ncnPath = dir;
+        updateWatchRoots();
+        return true;
+    } else {
+        return false;
+    }
+}
 
-    cur = cur.replace("/Song/", "/Cursor/");
+void SongDatabase::setUpdateType(UpdateType type)
+{
+    upType = type;
+}
 
-    cur = cur.replace(cur.length()-4, 4, ".CUR");
-    if (QFile::exists(cur))
-        return cur;
+void SongDatabase::requestUpdate(UpdateType type)
+{
+    // the running one covers what the watcher saw, a full update waits for it
+    if (isRunning()) {
+        if (type != UpdateType::UpdateChanged && upType == UpdateType::UpdateChanged)
+            pendingFullUpdate = true;
+        return;
+    }
 
-    cur = cur.replace(cur.length()-4, 4, ".cur");
-    if (QFile::exists(cur))
-        return cur;
+    upType = type;
 
-    cur = cur.replace(cur.length()-4, 4, ".Cur");
-    if (QFile::exists(cur))
-        return cur;
+    if (type == UpdateType::UpdateChanged)
+        start(QThread::LowPriority);
+    else
+        start();
+}
 
-    return "";
+void SongDatabase::setWatchEnabled(bool enabled)
+{
+    watchEnabled = enabled;
+    updateWatchRoots();
 }
 
-QString SongDatabase::getLyrFilePath(const QString &midFilePath)
+void SongDatabase::updateWatchRoots()
 {
-    QString lyr = midFilePath;
+    if (!watchEnabled || !isNCNPath(_ncnPath)) {
+        watcher->clear();
+        return;
+    }
 
-    lyr = lyr.replace("/Song/", "/Lyrics/");
+    // a cur or lyr can come after its mid, the NCN trees are watched together
+    QStringList roots;
+    roots << _ncnPath + "/Song" << _ncnPath + "/Cursor" << _ncnPath + "/Lyrics";
+    if (!_hnkPath.isEmpty())
+        roots << _hnkPath;
+    if (!_karPath.isEmpty())
+        roots << _karPath;
 
-    lyr = lyr.replace(lyr.length()-4, 4, ".LYR");
-    if (QFile::exists(lyr))
-        return lyr;
+    watcher->setRoots(roots);
 
-    lyr = lyr.replace(lyr.length()-4, 4, ".lyr");
-    if (QFile::exists(lyr))
-        return lyr;
+    checkReindex();
+}
 
-    lyr = lyr.replace(lyr.length()-4, 4, ".Lyr");
-    if (QFile::exists(lyr))
-        return lyr;
+void SongDatabase::checkReindex()
+{
+    // until a full update fills files again the watcher's runs do nothing
+    if (!reindexNeeded || !watchEnabled || !isNCNPath(_ncnPath))
+        return;
 
-    return "";
+    reindexNeeded = false;
+    requestUpdate(UpdateType::UpdateAll);
 }
 
-bool SongDatabase::setNcnPath(const QString &dir)
+void SongDatabase::onLibraryChanged(const QStringList &dirs)
 {
-    if (isNCNPath(dir)) {
-        _ncnPath = dir;
-        return true;
-    } else {
-        return false;
+    {
+        std::lock_guard<std::mutex> lock(changedMutex);
+        for (const QString &dir : dirs)
+            changedDirs.insert(dir);
     }
+
+    // a running update starts the next one when it is finished
+    requestUpdate(UpdateType::UpdateChanged);
 }
 
-void SongDatabase::setUpdateType(UpdateType type)
+void SongDatabase::onUpdateFinished()
 {
-    upType = type;
+    if (pendingFullUpdate && !isRunning()) {
+        pendingFullUpdate = false;
+        requestUpdate(UpdateType::UpdateAll);
+        return;
+    }
+
+    bool pending;
+    {
+        std::lock_guard<std::mutex> lock(changedMutex);
+        pending = !changedDirs.isEmpty();
+    }
+
+    if (pending && watchEnabled && !isRunning()) {
+        upType = UpdateType::UpdateChanged;
+        start(QThread::LowPriority);
+    }
 }
 
-bool SongDatabase::insertNCN(const QString &ncnPath, const QString &songId, const QString &midFilePath)
+bool SongDatabase::parseNCN(const QString &ncnPath, const QString &songId, const QString &midFilePath, SongRecord *song)
 {
     QString id = songId;
 
-    QString curFilePath = getCurFilePath(midFilePath);
-    QString lyrFilePath = getLyrFilePath(midFilePath);
+    QString curFilePath = CompanionResolver::curFilePath(midFilePath);
+    QString lyrFilePath = CompanionResolver::lyrFilePath(midFilePath);
 
     if (curFilePath == "" || lyrFilePath == "")
         return false;
@@ -219,47 +316,36 @@ bool SongDatabase::insertNCN(const QString &ncnPath, const QString &songId, cons
     if (!file.open(QFile::ReadOnly))
         return false;
 
-    QTextStream textStream(&file);
-    textStream.setCodec("TIS-620");
+    // the header and the first lyric lines
+    QStringList lines = NCNDecoder::lyrLines(file.readAll(), 8);
 
-    QString name = textStream.readLine();
-    QString artist = textStream.readLine();
-    QString key = textStream.readLine();
-    QString type = "NCN";
+    file.close();
 
-    textStream.readLine();
+    QString name = lines[0];
+    QString artist = lines[1];
+    QString key = lines[2];
+    QString type = "NCN";
 
-    QString lyr = textStream.readLine() + " ";
-    lyr += textStream.readLine() + " ";
-    lyr += textStream.readLine() + " ";
-    lyr += textStream.readLine();
-
-    file.close();
+    QString lyr = lines[4] + " " + lines[5] + " " + lines[6] + " " + lines[7];
 
     QString path = midFilePath;
     path = path.replace(ncnPath, "");
 
-    // Insert to database
-    QSqlQuery query;
-    query.prepare("INSERT INTO songs VALUES "
-                  "(?, ?, ?, ?, ?, ?, ?, ?);");
-    query.bindValue(0, id);
-    query.bindValue(1, name);
-    query.bindValue(2, artist);
-    query.bindValue(3, key);
-    query.bindValue(4, bpm);
-    query.bindValue(5, type);
-    query.bindValue(6, lyr);
-    query.bindValue(7, path);
+    song->id = id;
+    song->name = name;
+    song->artist = artist;
+    song->key = key;
+    song->tempo = bpm;
+    song->type = type;
+    song->lyrics = lyr;
+    song->path = path;
 
-    query.exec();
-    query.finish();
-    query.clear();
+    MidiAnalyzer::analyzeFile(midFilePath, &song->info);
 
     return true;
 }
 
-bool SongDatabase::insertHNK(const QString &hnkPath, const QString &songId, const QString &hnkFilePath)
+bool SongDatabase::parseHNK(const QString &hnkPath, const QString &songId, const QString &hnkFilePath, SongRecord *song)
 {
     QString id = songId;
 
@@ -269,46 +355,33 @@ bool SongDatabase::insertHNK(const QString &hnkPath, const QString &songId, cons
 
     // Read Lyrics
     QByteArray lyrData = HNKFile::lyrData(hnkFilePath);
+    QStringList lines = NCNDecoder::lyrLines(lyrData, 8);
 
-    QTextStream textStream(&lyrData);
-    textStream.setCodec("TIS-620");
-
-    QString name = textStream.readLine();
-    QString artist = textStream.readLine();
-    QString key = textStream.readLine();
+    QString name = lines[0];
+    QString artist = lines[1];
+    QString key = lines[2];
     QString type = "HNK";
 
-    textStream.readLine();
-
-    QString lyr = textStream.readLine() + " ";
-    lyr += textStream.readLine() + " ";
-    lyr += textStream.readLine() + " ";
-    lyr += textStream.readLine();
+    QString lyr = lines[4] + " " + lines[5] + " " + lines[6] + " " + lines[7];
 
     QString path = hnkFilePath;
     path = path.replace(hnkPath, "");
 
-    // Insert to database
-    QSqlQuery query;
-    query.prepare("INSERT INTO songs VALUES "
-                  "(?, ?, ?, ?, ?, ?, ?, ?);");
-    query.bindValue(0, id);
-    query.bindValue(1, name);
-    query.bindValue(2, artist);
-    query.bindValue(3, key);
-    query.bindValue(4, bpm);
-    query.bindValue(5, type);
-    query.bindValue(6, lyr);
-    query.bindValue(7, path);
+    song->id = id;
+    song->name = name;
+    song->artist = artist;
+    song->key = key;
+    song->tempo = bpm;
+    song->type = type;
+    song->lyrics = lyr;
+    song->path = path;
 
-    query.exec();
-    query.finish();
-    query.clear();
+    MidiAnalyzer::analyze(HNKFile::midData(hnkFilePath), &song->info);
 
     return true;
 }
 
-bool SongDatabase::insertKAR(const QString &karPath, const QString &songId, const QString &karFilePath, const QString &fileName)
+bool SongDatabase::parseKAR(const QString &karPath, const QString &songId, const QString &karFilePath, const QString &fileName, SongRecord *song)
 {
     QString id = songId;
 
@@ -337,17 +410,61 @@ bool SongDatabase::insertKAR(const QString &karPath, const QString &songId, cons
     if (lyrics.size() > 3)
         lyr += lyrics[3];
 
+    song->id = id;
+    song->name = name;
+    song->artist = "";
+    song->key = "";
+    song->tempo = bpm;
+    song->type = type;
+    song->lyrics = lyr;
+    song->path = path;
+
+    MidiAnalyzer::analyzeFile(karFilePath, &song->info);
+
+    return true;
+}
+
+static const char SONG_INSERT_SQL[] =
+        "INSERT INTO songs (id, name, artist, keyname, tempo, songtype, lyrics, path, "
+                           "id_key, name_key, artist_key, "
+                           "duration_ms, tempo_min, tempo_max, time_signatures, channels, programs, "
+                           "drum_kits, presets, note_density, max_polyphony, first_note_ms) "
+        "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)";
+
+static void bindSong(QSqlQuery *query, const SongRecord &song)
+{
+    query->bindValue(0, song.id);
+    query->bindValue(1, song.name);
+    query->bindValue(2, song.artist);
+    query->bindValue(3, song.key);
+    query->bindValue(4, song.tempo);
+    query->bindValue(5, song.type);
+    query->bindValue(6, song.lyrics);
+    query->bindValue(7, song.path);
+    query->bindValue(8, SongDatabase::searchKey(song.id));
+    query->bindValue(9, SongDatabase::searchKey(song.name));
+    query->bindValue(10, SongDatabase::searchKey(song.artist));
+
+    // nulls when the midi could not be analyzed
+    const SongAnalysis &a = song.info;
+    query->bindValue(11, a.valid ? QVariant(a.durationMs) : QVariant());
+    query->bindValue(12, a.valid ? QVariant(a.tempoMin) : QVariant());
+    query->bindValue(13, a.valid ? QVariant(a.tempoMax) : QVariant());
+    query->bindValue(14, a.valid ? QVariant(a.timeSignatures) : QVariant());
+    query->bindValue(15, a.valid ? QVariant(a.channels) : QVariant());
+    query->bindValue(16, a.valid ? QVariant(a.programs) : QVariant());
+    query->bindValue(17, a.valid ? QVariant(a.drumKits) : QVariant());
+    query->bindValue(18, a.valid ? QVariant(a.presets) : QVariant());
+    query->bindValue(19, a.valid ? QVariant(a.noteDensity) : QVariant());
+    query->bindValue(20, a.valid ? QVariant(a.maxPolyphony) : QVariant());
+    query->bindValue(21, a.valid ? QVariant(a.firstNoteMs) : QVariant());
+}
+
+static bool insertSong(const SongRecord &song)
+{
     QSqlQuery query;
-    query.prepare("INSERT INTO songs VALUES "
-                  "(?, ?, ?, ?, ?, ?, ?, ?);");
-    query.bindValue(0, id);
-    query.bindValue(1, name);
-    query.bindValue(2, "");
-    query.bindValue(3, "");
-    query.bindValue(4, bpm);
-    query.bindValue(5, type);
-    query.bindValue(6, lyr);
-    query.bindValue(7, path);
+    query.prepare(SONG_INSERT_SQL);
+    bindSong(&query, song);
 
     query.exec();
     query.finish();
@@ -356,204 +473,126 @@ bool SongDatabase::insertKAR(const QString &karPath, const QString &songId, cons
     return true;
 }
 
-Song* SongDatabase::nextType(const QString &s)
+bool SongDatabase::insertNCN(const QString &ncnPath, const QString &songId, const QString &midFilePath)
+{
+    SongRecord song;
+    if (!parseNCN(ncnPath, songId, midFilePath, &song))
+        return false;
+
+    return insertSong(song);
+}
+
+bool SongDatabase::insertHNK(const QString &hnkPath, const QString &songId, const QString &hnkFilePath)
+{
+    SongRecord song;
+    if (!parseHNK(hnkPath, songId, hnkFilePath, &song))
+        return false;
+
+    return insertSong(song);
+}
+
+bool SongDatabase::insertKAR(const QString &karPath, const QString &songId, const QString &karFilePath, const QString &fileName)
+{
+    SongRecord song;
+    if (!parseKAR(karPath, songId, karFilePath, fileName, &song))
+        return false;
+
+    return insertSong(song);
+}
+
+void SongDatabase::nextType(const QString &s)
 {
-    Song *sg = song;
     switch (searchType) {
     case SearchType::ByAll:
         searchType = SearchType::ById;
-        sg = search(s);
+        search(s);
         break;
     case SearchType::ById:
         searchType = SearchType::ByName;
-        sg = search(_searchText);
+        search(_searchText);
         break;
     case SearchType::ByName:
         searchType = SearchType::ByArtist;
-        sg = search(_searchText);
+        search(_searchText);
         break;
     case SearchType::ByArtist:
         searchType = SearchType::ByAll;
-        sg = search(_searchText);
+        search(_searchText);
         break;
     }
-    return sg;
 }
 
-void setSong(Song *s, QSqlQuery *qry) {
-    s->setId(qry->value(0).toString());
-    s->setName(qry->value(1).toString());
-    s->setArtist(qry->value(2).toString());
-    s->setKey(qry->value(3).toString());
-    s->setTempo(qry->value(4).toInt());
-    s->setSongType(qry->value(5).toString());
-    s->setLyrics(qry->value(6).toString());
-    s->setPath(qry->value(7).toString());
+static void setSong(Song *s, const SongRecord &r) {
+    s->setId(r.id);
+    s->setName(r.name);
+    s->setArtist(r.artist);
+    s->setKey(r.key);
+    s->setTempo(r.tempo);
+    s->setSongType(r.type);
+    s->setLyrics(r.lyrics);
+    s->setPath(r.path);
 
     s->setBpmSpeed(0);
     s->setTranspose(0);
 }
 
-Song *SongDatabase::search(const QString &s)
+void SongDatabase::search(const QString &s)
 {
-    QString sql = "";
     _searchText = s;
-    currentResultIndex = 0;
-
-    switch (searchType) {
-    case SearchType::ByAll:
-        sql = "SELECT * FROM (SELECT * FROM songs WHERE id LIKE ? AND songtype != 'KAR' ORDER BY id LIMIT 1) "
-              "UNION ALL "
-              "SELECT * FROM (SELECT * FROM songs WHERE name LIKE ? AND songtype != 'KAR' ORDER BY name LIMIT 1) "
-              "UNION ALL "
-              "SELECT * FROM (SELECT * FROM songs WHERE artist LIKE ? AND songtype != 'KAR' ORDER BY artist LIMIT 1) "
-              "UNION ALL "
-              "SELECT * FROM (SELECT * FROM songs WHERE name LIKE ? AND songtype = 'KAR' ORDER BY name LIMIT 1) "
-              "LIMIT 1";
-        break;
-    case SearchType::ById:
-        sql = "SELECT * FROM songs WHERE id LIKE ? "
-              "ORDER BY id, name, artist LIMIT 1";
-        break;
-    case SearchType::ByName:
-        sql = "SELECT * FROM songs WHERE name LIKE ? "
-              "ORDER BY name, artist, id LIMIT 1";
-        break;
-    case SearchType::ByArtist:
-        sql = "SELECT * FROM songs WHERE artist LIKE ? "
-              "ORDER BY artist, name, id LIMIT 1";
-        break;
-    }
 
-    QSqlQuery query;
-    if (searchType == SearchType::ByAll) {
-        query.prepare(sql);
-        query.bindValue(0, s + "%");
-        query.bindValue(1, s + "%");
-        query.bindValue(2, s + "%");
-        query.bindValue(3, "%" + s + "%");
-    } else {
-        query.prepare(sql);
-        query.bindValue(0, s + "%");
-    }
-
-    if (query.exec()) {
-        if (query.next()) {
-            setSong(song, &query);
-        }
-    }
-    query.finish();
-    query.clear();
+    // a newer search drops what is queued or running for the older ones
+    searchGen++;
+    searcher->setGeneration(searchGen);
 
-    return song;
+    emit searchRequested(searchGen, s, searchType, useFts);
 }
 
-Song *SongDatabase::searchNext()
+void SongDatabase::searchNext()
 {
-    QString sql = "";
-
-    switch (searchType) {
-    case SearchType::ByAll:
-        sql = "SELECT * FROM (SELECT * FROM songs WHERE id LIKE ? AND songtype != 'KAR' ORDER BY id, name, artist) "
-              "UNION ALL "
-              "SELECT * FROM (SELECT * FROM songs WHERE name LIKE ? AND songtype != 'KAR' ORDER BY name, artist, id) "
-              "UNION ALL "
-              "SELECT * FROM (SELECT * FROM songs WHERE artist LIKE ? AND songtype != 'KAR' ORDER BY artist, name, id) "
-              "UNION ALL "
-              "SELECT * FROM (SELECT * FROM songs WHERE name LIKE ? AND songtype = 'KAR' ORDER BY name, artist, id) ";
-        break;
-    case SearchType::ById:
-        sql = "SELECT * FROM songs WHERE id LIKE ? "
-              "ORDER BY id, name, artist";
-        break;
-    case SearchType::ByName:
-        sql = "SELECT * FROM songs WHERE name LIKE ? "
-              "ORDER BY name, artist, id";
-        break;
-    case SearchType::ByArtist:
-        sql = "SELECT * FROM songs WHERE artist LIKE ? "
-              "ORDER BY artist, name, id";
-        break;
-    }
-
-    QSqlQuery q;
-    q.prepare(sql);
-
-    if (searchType == SearchType::ByAll) {
-        q.bindValue(0, _searchText + "%");
-        q.bindValue(1, _searchText + "%");
-        q.bindValue(2, _searchText + "%");
-        q.bindValue(3, "%" + _searchText + "%");
-    } else {
-        q.bindValue(0, _searchText + "%");
-    }
-
-    if (q.exec() && q.seek(currentResultIndex + 1)) {
-        currentResultIndex++;
-        setSong(song, &q);
-    }
-
-    q.finish();
-    q.clear();
+    emit searchNextRequested(searchGen);
+}
 
-    return song;
+void SongDatabase::searchPrevious()
+{
+    emit searchPreviousRequested(searchGen);
 }
 
-Song *SongDatabase::searchPrevious()
+void SongDatabase::onSearchIndexChanged(qint64 bytes)
 {
-    QString sql = "";
+    indexBytes = bytes;
+}
 
-    switch (searchType) {
-    case SearchType::ByAll:
-        sql = "SELECT * FROM (SELECT * FROM songs WHERE id LIKE ? AND songtype != 'KAR' ORDER BY id, name, artist) "
-              "UNION ALL "
-              "SELECT * FROM (SELECT * FROM songs WHERE name LIKE ? AND songtype != 'KAR' ORDER BY name, artist, id) "
-              "UNION ALL "
-              "SELECT * FROM (SELECT * FROM songs WHERE artist LIKE ? AND songtype != 'KAR' ORDER BY artist, name, id) "
-              "UNION ALL "
-              "SELECT * FROM (SELECT * FROM songs WHERE name LIKE ? AND songtype = 'KAR' ORDER BY name, artist, id) ";
-        break;
-    case SearchType::ById:
-        sql = "SELECT * FROM songs WHERE id LIKE ? "
-              "ORDER BY id, name, artist";
-        break;
-    case SearchType::ByName:
-        sql = "SELECT * FROM songs WHERE name LIKE ? "
-              "ORDER BY name, artist, id";
-        break;
-    case SearchType::ByArtist:
-        sql = "SELECT * FROM songs WHERE artist LIKE ? "
-              "ORDER BY artist, name, id";
-        break;
-    }
+void SongDatabase::onSearchFound(int gen, const SongRecord &r)
+{
+    if (gen != searchGen)
+        return;
 
-    QSqlQuery q;
-    q.prepare(sql);
+    answeredGen = gen;
+    songFound = true;
+    setSong(song, r);
 
-    if (searchType == SearchType::ByAll) {
-        q.bindValue(0, _searchText + "%");
-        q.bindValue(1, _searchText + "%");
-        q.bindValue(2, _searchText + "%");
-        q.bindValue(3, "%" + _searchText + "%");
-    } else {
-        q.bindValue(0, _searchText + "%");
-    }
+    emit searchFinished(song);
+}
 
-    if (q.exec() && q.seek(currentResultIndex - 1)) {
-        currentResultIndex--;
-        setSong(song, &q);
-    }
+void SongDatabase::onSearchNotFound(int gen)
+{
+    if (gen != searchGen)
+        return;
 
-    q.finish();
-    q.clear();
+    // the frame must not keep showing the song of the last search
+    answeredGen = gen;
+    songFound = false;
+    setSong(song, SongRecord());
 
-    return song;
+    emit searchFinished(song);
 }
 
 bool SongDatabase::removeCurrentSong(bool removeFromStorage)
 {
    QString sql = "DELETE FROM songs WHERE id = ? AND name = ? AND songtype = ? AND path = ?";
 
+   db.transaction();
+
    QSqlQuery q;
    q.prepare(sql);
    q.bindValue(0, song->id());
@@ -561,21 +600,44 @@ bool SongDatabase::removeCurrentSong(bool removeFromStorage)
    q.bindValue(2, song->songType());
    q.bindValue(3, song->path());
 
-   if (!q.exec())
+   if (!q.exec()) {
+       db.rollback();
+       return false;
+   }
+
+   q.finish();
+   q.clear();
+
+   // with its files row left the rescan sees an unchanged file, an update
+   // brings back a song removed from the database only
+   q.prepare("DELETE FROM files WHERE songtype = ? AND path = ?");
+   q.bindValue(0, song->songType());
+   q.bindValue(1, song->path());
+
+   if (!q.exec()) {
+       db.rollback();
        return false;
+   }
 
    q.finish();
    q.clear();
 
-   currentResultIndex--;
+   db.commit();
+
+   SongRecord removed;
+   removed.id = song->id();
+   removed.name = song->name();
+   removed.type = song->songType();
+   removed.path = song->path();
+   emit removeRequested(searchGen, removed);
 
    if (removeFromStorage)
    {
        if (song->songType() == "NCN")
        {
            QString midFilePath = _ncnPath + song->path();
-           QString curFilePath = getCurFilePath(midFilePath);
-           QString lyrFilePath = getLyrFilePath(midFilePath);
+           QString curFilePath = CompanionResolver::curFilePath(midFilePath);
+           QString lyrFilePath = CompanionResolver::lyrFilePath(midFilePath);
 
            QFile f(midFilePath);
            f.remove();
@@ -585,6 +647,9 @@ bool SongDatabase::removeCurrentSong(bool removeFromStorage)
 
            f.setFileName(lyrFilePath);
            f.remove();
+
+           CompanionResolver::invalidate(QFileInfo(curFilePath).path());
+           CompanionResolver::invalidate(QFileInfo(lyrFilePath).path());
        }
        else if (song->songType() == "HNK")
        {
@@ -603,126 +668,356 @@ bool SongDatabase::removeCurrentSong(bool removeFromStorage)
    return true;
 }
 
-void SongDatabase::run()
+static QStringList songFilters(const QString &type)
 {
-    if (!db.isOpen()) {
-        return;
-    }
+    if (type == "NCN")
+        return QStringList() << "*.mid" << "*.MID";
+    else if (type == "HNK")
+        return QStringList() << "*.hnk" << "*.HNK";
+    else
+        return QStringList() << "*.kar" << "*.KAR" << "*.mid" << "*.MID";
+}
 
+void SongDatabase::run()
+{
     if (!isNCNPath(_ncnPath)) {
         return;
     }
 
-    int count = 0;
+    // a connection belongs to the thread that opened it, the gui
+    // thread reads and removes songs through db meanwhile
+    {
+        QSqlDatabase conn = QSqlDatabase::addDatabase("QSQLITE", UPDATE_CONNECTION);
+        conn.setDatabaseName(DATABASE_FILE_PATH);
 
-    // Count mid file in NCN
-    QDir dir(_ncnPath + "/Song");
-    QDir hnkDir(_hnkPath);
-    QDir karDir(_karPath);
+        if (conn.open()) {
+            setPragmas(conn);
 
-    QDirIterator iter1(dir.path() ,QStringList() << "*.mid" << "*.MID",
-                    QDir::Files, QDirIterator::Subdirectories);
-    while (iter1.hasNext()) {
-        iter1.next();
-        count++;
-    }
+            if (upType == UpdateType::UpdateChanged)
+                updateChanged(conn);
+            else
+                updateAll(conn);
 
-    QDirIterator iter2(hnkDir.path() ,QStringList() << "*.hnk" << "*.HNK",
-                    QDir::Files, QDirIterator::Subdirectories);
-    while (iter2.hasNext()) {
-        iter2.next();
-        count++;
+            conn.close();
+        }
     }
 
-    QDirIterator iter3(karDir.path() ,QStringList() << "*.kar" << "*.KAR" << "*.mid" << "*.MID",
-                    QDir::Files, QDirIterator::Subdirectories);
-    while (iter3.hasNext()) {
-        iter3.next();
-        count++;
-    }
+    QSqlDatabase::removeDatabase(UPDATE_CONNECTION);
+}
 
-    upCount = count;
-    emit updateCountChanged(count);
+void SongDatabase::updateAll(QSqlDatabase &conn)
+{
+    // the full update sees every change the watcher has waiting
+    {
+        std::lock_guard<std::mutex> lock(changedMutex);
+        changedDirs.clear();
+    }
+    CompanionResolver::invalidate();
 
     upTing = true;
+    upCount = 0;
+    upPosition = 0;
 
-    QSqlQuery q;
-    q.exec("DELETE FROM songs");
-    q.exec("vacuum");
-    q.finish();
-    q.clear();
+    createFilesTable(conn);
 
-    db.transaction();
+    QHash<QString, FileStamp> indexed = indexedFiles(conn);
 
-    dropIndex();
+    QSqlQuery q(conn);
 
+    // songs of a database from before the files table can't be
+    // matched to their files, index everything once
+    if (indexed.isEmpty()) {
+        q.exec("DELETE FROM songs");
+        q.finish();
+        q.clear();
+    }
 
-    // Update NCN
-    int i = 0;
-    int erCount = 0;
-    QDirIterator it(dir.path() ,QStringList() << "*.mid" << "*.MID",
-                     QDir::Files, QDirIterator::Subdirectories);
-    while (it.hasNext()) {
+    LibraryIndexer indexer;
+    indexer.addRoot("NCN", _ncnPath, _ncnPath + "/Song", songFilters("NCN"));
+    indexer.addRoot("HNK", _hnkPath, _hnkPath, songFilters("HNK"));
+    indexer.addRoot("KAR", _karPath, _karPath, songFilters("KAR"));
+    indexer.start(indexed, QThread::idealThreadCount());
 
-        it.next();
+    QList<qint64> removedRows;
+    QList<qint64> addedRows;
 
-        i++;
-        emit updatePositionChanged(i);
-        emit updateSongNameChanged(it.fileName());
+    writeResults(conn, &indexer, true, 0, &removedRows, &addedRows, nullptr);
 
-        QString id = it.fileName().section(".", 0, 0);
+    if (indexed.isEmpty())
+        emit songsReset();
+    else if (!removedRows.isEmpty() || !addedRows.isEmpty())
+        emit songsChanged(removedRows, addedRows);
 
-        bool result = insertNCN(_ncnPath, id, it.filePath());
+    upTing = false;
+}
 
-        if (!result)
-            erCount ++;
+void SongDatabase::updateChanged(QSqlDatabase &conn)
+{
+    QStringList dirs;
+    {
+        std::lock_guard<std::mutex> lock(changedMutex);
+        dirs = changedDirs.toList();
+        changedDirs.clear();
     }
 
+    for (const QString &dir : dirs)
+        CompanionResolver::invalidate(dir);
+
+    createFilesTable(conn);
+
+    // before the first full update there is nothing to compare with
+    QHash<QString, FileStamp> all = indexedFiles(conn);
+    if (dirs.isEmpty() || all.isEmpty())
+        return;
+
+    typedef struct
+    {
+        QString type;
+        QString root;
+        QString rel;        // the directory as in songs.path
+    } Target;
+
+    // watched directory -> the song directory it belongs to
+    QHash<QString, Target> targets;
+
+    QString ncn = QDir::cleanPath(_ncnPath);
+    QString hnk = QDir::cleanPath(_hnkPath);
+    QString kar = QDir::cleanPath(_karPath);
+
+    for (const QString &dir : dirs) {
+        Target t;
+
+        if (dir.startsWith(ncn + "/")) {
+            QString rel = dir.mid(ncn.length());
+            QString tree = rel.section("/", 1, 1);
+
+            // cur and lyr are part of the stamp of the mid with the same name
+            if (tree.compare("Cursor", Qt::CaseInsensitive) == 0 || tree.compare("Lyrics", Qt::CaseInsensitive) == 0)
+                rel = "/Song" + rel.mid(1 + tree.length());
+            else if (tree.compare("Song", Qt::CaseInsensitive) != 0)
+                continue;
+
+            t.type = "NCN";
+            t.root = _ncnPath;
+            t.rel = rel;
+        }
+        else if (!_hnkPath.isEmpty() && (dir == hnk || dir.startsWith(hnk + "/"))) {
+            t.type = "HNK";
+            t.root = _hnkPath;
+            t.rel = dir.mid(hnk.length());
+        }
+        else if (!_karPath.isEmpty() && (dir == kar || dir.startsWith(kar + "/"))) {
+            t.type = "KAR";
+            t.root = _karPath;
+            t.rel = dir.mid(kar.length());
+        }
+        else {
+            continue;
+        }
 
-    // Update HNK
-    QDirIterator it2(hnkDir.path() ,QStringList() << "*.hnk" << "*.HNK",
-                     QDir::Files, QDirIterator::Subdirectories);
-    while (it2.hasNext()) {
+        targets.insert(t.type + ":" + t.rel, t);
+    }
 
-        it2.next();
+    LibraryIndexer indexer;
 
-        i++;
-        emit updatePositionChanged(i);
-        emit updateSongNameChanged(it2.fileName());
+    // the songs the directories have now, a removed directory takes its subdirectories
+    QSet<QString> listed;
+    QStringList removed;
 
-        QString hnkId = it2.fileName().section(".", 0, 0);
+    for (const Target &t : targets) {
+        QDir dir(t.root + t.rel);
+        if (!dir.exists()) {
+            removed << t.type + ":" + t.rel + "/";
+            continue;
+        }
 
-        bool result = insertHNK(_hnkPath, hnkId, it2.filePath());
+        listed.insert(t.type + ":" + t.rel);
 
-        if (!result)
-            erCount ++;
+        for (const QFileInfo &info : dir.entryInfoList(songFilters(t.type), QDir::Files)) {
+            LibraryFile f;
+            f.type = t.type;
+            f.root = t.root;
+            f.filePath = t.root + t.rel + "/" + info.fileName();
+            f.fileName = info.fileName();
+            indexer.addFile(f);
+        }
     }
 
-    // Update KAR
-    QDirIterator it3(karDir.path() ,QStringList() << "*.kar" << "*.KAR" << "*.mid" << "*.MID",
-                     QDir::Files, QDirIterator::Subdirectories);
-    while (it3.hasNext()) {
+    // what was indexed there, the ones not listed are deleted
+    QHash<QString, FileStamp> indexed;
+
+    for (QHash<QString, FileStamp>::const_iterator it = all.constBegin(); it != all.constEnd(); ++it) {
+        const QString &key = it.key();
+        QString dir = key.left(key.lastIndexOf("/"));
+
+        bool take = listed.contains(dir);
+        for (int i=0; !take && i<removed.count(); i++)
+            take = key.startsWith(removed[i]);
+
+        if (take)
+            indexed.insert(key, it.value());
+    }
 
-        it3.next();
+    indexer.start(indexed, QThread::idealThreadCount());
 
-        i++;
-        emit updatePositionChanged(i);
-        emit updateSongNameChanged(it3.fileName());
+    QList<qint64> removedRows;
+    QList<qint64> addedRows;
+    QStringList unsettled;
 
-        QString karId = "-------";
+    writeResults(conn, &indexer, false, QDateTime::currentMSecsSinceEpoch() - SETTLE_MS,
+                 &removedRows, &addedRows, &unsettled);
 
-        bool result = insertKAR(_karPath, karId, it3.filePath(), it3.fileName());
+    if (!removedRows.isEmpty() || !addedRows.isEmpty())
+        emit songsChanged(removedRows, addedRows);
 
-        if (!result)
-            erCount ++;
+    if (!unsettled.isEmpty())
+        emit directoriesUnsettled(unsettled);
+}
+
+void SongDatabase::writeResults(QSqlDatabase &conn, LibraryIndexer *indexer, bool progress, qint64 settleAfter,
+                                QList<qint64> *removedRows, QList<qint64> *addedRows, QStringList *unsettled)
+{
+    // statements are prepared once, a song removed from the gui waits
+    // on the busy timeout for the open batch to commit
+    QSqlQuery songInsert(conn);
+    songInsert.prepare(SONG_INSERT_SQL);
+
+    QSqlQuery songDelete(conn);
+    songDelete.prepare("DELETE FROM songs WHERE songtype = ? AND path = ?");
+
+    // the rowids for the search worker's prefix index
+    QSqlQuery songRows(conn);
+    songRows.prepare("SELECT rowid FROM songs WHERE songtype = ? AND path = ?");
+
+    auto deleteSongs = [&](const QString &type, const QString &path) {
+        songRows.bindValue(0, type);
+        songRows.bindValue(1, path);
+        if (songRows.exec()) {
+            while (songRows.next())
+                *removedRows << songRows.value(0).toLongLong();
+        }
+        songRows.finish();
+
+        songDelete.bindValue(0, type);
+        songDelete.bindValue(1, path);
+        songDelete.exec();
+    };
+
+    QSqlQuery fileSave(conn);
+    fileSave.prepare("INSERT OR REPLACE INTO files VALUES (?, ?, ?, ?, ?)");
+
+    QSqlQuery fileDelete(conn);
+    fileDelete.prepare("DELETE FROM files WHERE songtype = ? AND path = ?");
+
+    conn.transaction();
+
+    int writes = 0;
+    QString lastName = "";
+    QElapsedTimer progressTimer;
+    progressTimer.start();
+    QElapsedTimer commitTimer;
+    commitTimer.start();
+
+    for (;;) {
+
+        IndexResult r;
+
+        if (indexer->takeResult(&r, PROGRESS_INTERVAL_MS)) {
+
+            if (r.action == IndexAction::Parsed) {
+                if (r.replace)
+                    deleteSongs(r.file.type, r.path);
+
+                if (r.ok) {
+                    bindSong(&songInsert, r.song);
+                    if (songInsert.exec())
+                        *addedRows << songInsert.lastInsertId().toLongLong();
+                }
+
+                lastName = r.file.fileName;
+            }
+
+            fileSave.bindValue(0, r.file.type);
+            fileSave.bindValue(1, r.path);
+            fileSave.bindValue(2, r.stamp.size);
+            fileSave.bindValue(3, r.stamp.mtime);
+            fileSave.bindValue(4, r.stamp.hash);
+            fileSave.exec();
+
+            // maybe a part of a copy, written now and looked at again
+            if (unsettled != nullptr && r.stamp.mtime > settleAfter) {
+                QString dir = QFileInfo(r.file.filePath).absolutePath();
+                if (!unsettled->contains(dir))
+                    *unsettled << dir;
+            }
+
+            // by count or by time, a slow disk must not keep the write lock for long
+            if (++writes >= WRITE_BATCH_SIZE || commitTimer.elapsed() >= COMMIT_INTERVAL_MS) {
+                conn.commit();
+                conn.transaction();
+                writes = 0;
+                commitTimer.restart();
+            }
+        }
+        else if (indexer->isFinished()) {
+            break;
+        }
+        else if (writes > 0) {
+            // the workers are behind, let the gui in meanwhile
+            conn.commit();
+            conn.transaction();
+            writes = 0;
+            commitTimer.restart();
+        }
+
+        if (progress && progressTimer.elapsed() >= PROGRESS_INTERVAL_MS) {
+            emitProgress(indexer, lastName);
+            progressTimer.restart();
+        }
     }
 
+    // what is left was not found on the disk
+    QHash<QString, FileStamp> vanished = indexer->vanishedFiles();
+    for (const QString &key : vanished.keys()) {
+        QString type = key.section(":", 0, 0);
+        QString path = key.section(":", 1);
 
-    db.commit();
+        deleteSongs(type, path);
 
-    createIndex();
+        fileDelete.bindValue(0, type);
+        fileDelete.bindValue(1, path);
+        fileDelete.exec();
+    }
 
-    upTing = false;
+    conn.commit();
+
+    songInsert.finish();
+    songDelete.finish();
+    songRows.finish();
+    fileSave.finish();
+    fileDelete.finish();
+
+    if (progress)
+        emitProgress(indexer, lastName);
+}
+
+void SongDatabase::emitProgress(LibraryIndexer *indexer, const QString &fileName)
+{
+    // the walk runs ahead, the total grows until it is done
+    int found = indexer->foundCount();
+    if (found != upCount) {
+        upCount = found;
+        emit updateCountChanged(upCount);
+    }
+
+    int probed = indexer->probedCount();
+    if (upCount > 0 && probed != upPosition) {
+        upPosition = probed;
+        emit updatePositionChanged(upPosition);
+    }
+
+    if (!fileName.isEmpty())
+        emit updateSongNameChanged(fileName);
 }
 
 void SongDatabase::createIndex()
@@ -730,49 +1025,304 @@ void SongDatabase::createIndex()
     QSqlQuery query;
     QString sql;
 
-    sql = "CREATE INDEX id_idx ON songs(id); ";
+    sql = "CREATE INDEX IF NOT EXISTS id_idx ON songs(id); ";
     query.exec(sql);
     query.finish();
     query.clear();
 
-    sql = "CREATE INDEX name_idx ON songs(name); ";
+    sql = "CREATE INDEX IF NOT EXISTS name_idx ON songs(name); ";
     query.exec(sql);
     query.finish();
     query.clear();
 
-    sql = "CREATE INDEX artist_idx ON songs(artist); ";
+    sql = "CREATE INDEX IF NOT EXISTS artist_idx ON songs(artist); ";
     query.exec(sql);
     query.finish();
     query.clear();
 
-    sql = "CREATE INDEX compound_idx ON songs(id,name,artist); ";
+    sql = "CREATE INDEX IF NOT EXISTS compound_idx ON songs(id,name,artist); ";
+    query.exec(sql);
+    query.finish();
+    query.clear();
+
+    // the searches range scan and order on the keys, rowid is the last key
+    sql = "DROP INDEX IF EXISTS name_sort_idx; ";
+    query.exec(sql);
+    sql = "DROP INDEX IF EXISTS artist_sort_idx; ";
+    query.exec(sql);
+    query.finish();
+    query.clear();
+
+    sql = "CREATE INDEX IF NOT EXISTS id_key_idx ON songs(id_key,name_key,artist_key); ";
+    query.exec(sql);
+    query.finish();
+    query.clear();
+
+    sql = "CREATE INDEX IF NOT EXISTS name_key_idx ON songs(name_key,artist_key,id_key); ";
+    query.exec(sql);
+    query.finish();
+    query.clear();
+
+    sql = "CREATE INDEX IF NOT EXISTS artist_key_idx ON songs(artist_key,name_key,id_key); ";
     query.exec(sql);
     query.finish();
     query.clear();
 }
 
-void SongDatabase::dropIndex()
+void SongDatabase::createKeyColumns()
 {
     QSqlQuery q;
-    QString sql;
 
-    sql = "DROP INDEX id_idx; ";
-    q.exec(sql);
+    q.exec("PRAGMA table_info(songs)");
+    bool exists = false;
+    while (q.next()) {
+        if (q.value(1).toString() == "name_key")
+            exists = true;
+    }
+    q.finish();
+    q.clear();
+
+    if (exists)
+        return;
+
+    q.exec("ALTER TABLE songs ADD COLUMN id_key TEXT");
+    q.exec("ALTER TABLE songs ADD COLUMN name_key TEXT");
+    q.exec("ALTER TABLE songs ADD COLUMN artist_key TEXT");
+    q.finish();
+    q.clear();
+
+    // sqlite can't compute the keys, fill the rows once from here
+    QList<qint64> rowids;
+    QList<SongRecord> songs;
+
+    q.setForwardOnly(true);
+    q.exec("SELECT rowid, id, name, artist FROM songs");
+    while (q.next()) {
+        SongRecord song;
+        song.id = q.value(1).toString();
+        song.name = q.value(2).toString();
+        song.artist = q.value(3).toString();
+        rowids << q.value(0).toLongLong();
+        songs << song;
+    }
+    q.finish();
+    q.clear();
+
+    db.transaction();
+
+    QSqlQuery update;
+    update.prepare("UPDATE songs SET id_key = ?, name_key = ?, artist_key = ? WHERE rowid = ?");
+    for (int i=0; i<rowids.count(); i++) {
+        update.bindValue(0, searchKey(songs[i].id));
+        update.bindValue(1, searchKey(songs[i].name));
+        update.bindValue(2, searchKey(songs[i].artist));
+        update.bindValue(3, rowids[i]);
+        update.exec();
+    }
+    update.finish();
+
+    db.commit();
+}
+
+void SongDatabase::createAnalysisColumns()
+{
+    QSqlQuery q;
+
+    q.exec("PRAGMA table_info(songs)");
+    bool exists = false;
+    while (q.next()) {
+        if (q.value(1).toString() == "duration_ms")
+            exists = true;
+    }
     q.finish();
     q.clear();
 
-    sql = "DROP INDEX name_idx; ";
-    q.exec(sql);
+    if (exists)
+        return;
+
+    const char *columns[] = {
+        "duration_ms INTEGER",
+        "tempo_min INTEGER",
+        "tempo_max INTEGER",
+        "time_signatures TEXT",
+        "channels INTEGER",
+        "programs TEXT",
+        "drum_kits TEXT",
+        "presets TEXT",
+        "note_density REAL",
+        "max_polyphony INTEGER",
+        "first_note_ms INTEGER"
+    };
+
+    for (const char *column : columns) {
+        q.exec(QString("ALTER TABLE songs ADD COLUMN ") + column);
+        q.finish();
+        q.clear();
+    }
+
+    // the midi files have to be read again, the next update indexes everything
+    createFilesTable(db);
+    q.exec("DELETE FROM files");
     q.finish();
     q.clear();
 
-    sql = "DROP INDEX artist_idx; ";
-    q.exec(sql);
+    // an upgraded library, a new one waits for the first update as before
+    q.exec("SELECT 1 FROM songs LIMIT 1");
+    reindexNeeded = q.next();
     q.finish();
     q.clear();
+}
+
+QString SongDatabase::searchKey(const QString &s)
+{
+    if (s.isNull())
+        return QString();
+
+    // compatibility forms (full width, ligatures) and accents split off
+    QString d = s.normalized(QString::NormalizationForm_KD).toCaseFolded();
+
+    QString key = "";
+    key.reserve(d.length());
+    bool space = false;
+
+    for (int i=0; i<d.length(); i++) {
+        QChar c = d.at(i);
+        ushort u = c.unicode();
 
-    sql = "DROP INDEX compound_idx; ";
-    q.exec(sql);
+        // latin accents, thai maitaikhu, tone marks, thanthakhat and yamakkan
+        if ((u >= 0x0300 && u <= 0x036F) || (u >= 0x0E47 && u <= 0x0E4C) || u == 0x0E4E)
+            continue;
+
+        // one space between words, none at the ends
+        if (c.isSpace()) {
+            space = !key.isEmpty();
+            continue;
+        }
+        if (space) {
+            key += QChar(' ');
+            space = false;
+        }
+
+        key += c;
+    }
+
+    // NFKD splits sara am into nikhahit and sara aa, a tone mark between them is gone
+    key.replace(QString(QChar(0x0E4D)) + QChar(0x0E32), QString(QChar(0x0E33)));
+
+    return key;
+}
+
+void SongDatabase::setPragmas(QSqlDatabase &conn)
+{
+    // readers are not blocked by the indexer, commits don't wait for the disk
+    QSqlQuery q(conn);
+    q.exec("PRAGMA journal_mode = WAL");
+    q.exec("PRAGMA synchronous = NORMAL");
+    q.exec("PRAGMA cache_size = -16384");
+    q.exec("PRAGMA temp_store = MEMORY");
     q.finish();
     q.clear();
 }
+
+void SongDatabase::createSearchIndex()
+{
+    QSqlQuery q;
+
+    q.exec("SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = 'songs_fts'");
+    bool exists = q.next();
+    q.finish();
+    q.clear();
+
+    if (!exists) {
+        // external content, the text stays only in songs
+        useFts = q.exec("CREATE VIRTUAL TABLE songs_fts USING fts5("
+                            "name, artist, lyrics, "
+                            "content = 'songs', content_rowid = 'rowid', "
+                            "tokenize = 'trigram'"
+                        ")");
+        q.finish();
+        q.clear();
+
+        if (!useFts)
+            return;
+    } else {
+        useFts = true;
+    }
+
+    // every writer of songs keeps the index in sync
+    q.exec("CREATE TRIGGER IF NOT EXISTS songs_fts_ai AFTER INSERT ON songs BEGIN "
+               "INSERT INTO songs_fts(rowid, name, artist, lyrics) "
+               "VALUES (new.rowid, new.name, new.artist, new.lyrics); "
+           "END");
+    q.exec("CREATE TRIGGER IF NOT EXISTS songs_fts_ad AFTER DELETE ON songs BEGIN "
+               "INSERT INTO songs_fts(songs_fts, rowid, name, artist, lyrics) "
+               "VALUES ('delete', old.rowid, old.name, old.artist, old.lyrics); "
+           "END");
+    q.exec("CREATE TRIGGER IF NOT EXISTS songs_fts_au AFTER UPDATE OF name, artist, lyrics ON songs BEGIN "
+               "INSERT INTO songs_fts(songs_fts, rowid, name, artist, lyrics) "
+               "VALUES ('delete', old.rowid, old.name, old.artist, old.lyrics); "
+               "INSERT INTO songs_fts(rowid, name, artist, lyrics) "
+               "VALUES (new.rowid, new.name, new.artist, new.lyrics); "
+           "END");
+    q.finish();
+    q.clear();
+
+    if (!exists)
+        rebuildSearchIndex();
+}
+
+void SongDatabase::rebuildSearchIndex()
+{
+    if (!useFts)
+        return;
+
+    QSqlQuery q;
+    q.exec("INSERT INTO songs_fts(songs_fts) VALUES ('rebuild')");
+    q.finish();
+    q.clear();
+}
+
+void SongDatabase::createFilesTable(QSqlDatabase &conn)
+{
+    QSqlQuery query(conn);
+    QString sql;
+
+    sql = "CREATE TABLE IF NOT EXISTS files ("
+              "songtype TEXT,"
+              "path     TEXT,"
+              "size     INTEGER,"
+              "mtime    INTEGER,"
+              "hash     TEXT,"
+              "PRIMARY KEY (songtype, path)"
+          ")";
+    query.exec(sql);
+    query.finish();
+    query.clear();
+
+    // songs of a changed or vanished file are found by path
+    sql = "CREATE INDEX IF NOT EXISTS path_idx ON songs(path); ";
+    query.exec(sql);
+    query.finish();
+    query.clear();
+}
+
+QHash<QString, FileStamp> SongDatabase::indexedFiles(QSqlDatabase &conn)
+{
+    QHash<QString, FileStamp> files;
+
+    QSqlQuery q(conn);
+    q.setForwardOnly(true);
+    q.exec("SELECT songtype, path, size, mtime, hash FROM files");
+    while (q.next()) {
+        FileStamp stamp;
+        stamp.size = q.value(2).toLongLong();
+        stamp.mtime = q.value(3).toLongLong();
+        stamp.hash = q.value(4).toString();
+
+        files.insert(q.value(0).toString() + ":" + q.value(1).toString(), stamp);
+    }
+    q.finish();
+    q.clear();
+
+    return files;
+}
@@ -2,22 +2,23 @@
 #define SONGDATABASE_H
 
 #include "Song.h"
+#include "LibraryIndexer.h"
+#include "LibraryWatcher.h"
+#include "SearchWorker.h"
 
+#include <QHash>
 #include <QObject>
+#include <QSet>
 #include <QSqlDatabase>
 #include <QThread>
 
+#include <mutex>
 
-enum class SearchType {
-    ByAll,
-    ById,
-    ByName,
-    ByArtist
-};
 
 enum class UpdateType {
     UpdateAll,
-    ImportNCN
+    ImportNCN,
+    UpdateChanged   // the directories the library watcher saw changing
 };
 
 class SongDatabase : public QThread
@@ -33,39 +34,60 @@ public:
     int count();
     Song* currentSong() { return song; }
     QString searchText() { return _searchText; }
+    // currentSong is the result of an older search until searchFinished
+    bool isSearchPending() { return answeredGen != searchGen; }
+    // false before the first result and after a search found nothing
+    bool hasSong() { return songFound; }
 
     QSqlDatabase* database() { return &db; }
 
     bool isOpenned() { return db.isOpen(); }
     bool isUpdatting() { return upTing; }
     int updateCount() { return upCount; }
+    // memory of the search worker's prefix index
+    qint64 searchIndexMemory() { return indexBytes; }
 
     static bool isNCNPath(const QString &dir);
-    static QString getCurFilePath(const QString &midFilePath);
-    static QString getLyrFilePath(const QString &midFilePath);
+    // case folded, no accents or thai tone marks, spaces collapsed
+    static QString searchKey(const QString &s);
 
     QString ncnPath() { return _ncnPath; }
     bool setNcnPath(const QString &dir);
 
     QString hnkPath() { return _hnkPath; }
-    void setHNKPath(const QString &p) { _hnkPath = p; }
+    void setHNKPath(const QString &p) { _hnkPath = p; updateWatchRoots(); }
 
     QString karPath() { return _karPath; }
-    void setKarPath(const QString &p) { _karPath = p; }
+    void setKarPath(const QString &p) { _karPath = p; updateWatchRoots(); }
+
+    // songs copied into or deleted from the folders are updated without a full update
+    bool isWatchEnabled() { return watchEnabled; }
+    void setWatchEnabled(bool enabled);
 
     UpdateType updateType() { return upType; }
     void setUpdateType(UpdateType type);
 
+    // starts the update, or queues it behind the one running
+    void requestUpdate(UpdateType type);
+    // a full update is running or waits for the watcher's run to finish
+    bool isFullUpdating() { return pendingFullUpdate || (isRunning() && upType != UpdateType::UpdateChanged); }
+
+    // file -> songs row, no database access (used by the index workers)
+    static bool parseNCN(const QString &ncnPath, const QString &songId, const QString &midFilePath, SongRecord *song);
+    static bool parseHNK(const QString &hnkPath, const QString &songId, const QString &hnkFilePath, SongRecord *song);
+    static bool parseKAR(const QString &karPath, const QString &songId, const QString &karFilePath, const QString &fileName, SongRecord *song);
+
 public slots:
     bool insertNCN(const QString &ncnPath, const QString &songId, const QString &midFilePath);
     bool insertHNK(const QString &hnkPath, const QString &songId, const QString &hnkFilePath);
     bool insertKAR(const QString &karPath, const QString &songId, const QString &karFilePath, const QString &fileName);
 
+    // the results come back with searchFinished
     void setSearchType(SearchType t) { searchType = t; }
-    Song *nextType(const QString &s);
-    Song* search(const QString &s);
-    Song* searchNext();
-    Song* searchPrevious();
+    void nextType(const QString &s);
+    void search(const QString &s);
+    void searchNext();
+    void searchPrevious();
 
     bool removeCurrentSong(bool removeFromStorage = false);
 
@@ -74,12 +96,51 @@ signals:
     void updatePositionChanged(int p);
     void updateSongNameChanged(QString n);
 
+    void searchFinished(Song *song);
+
+    void searchRequested(int gen, const QString &text, SearchType type, bool useFts);
+    void searchNextRequested(int gen);
+    void searchPreviousRequested(int gen);
+    void removeRequested(int gen, const SongRecord &song);
+
+    // from the rescan thread, rowids of the songs rows
+    void songsChanged(const QList<qint64> &removed, const QList<qint64> &added);
+    void songsReset();
+
+    // files still being written, the watcher looks again later
+    void directoriesUnsettled(const QStringList &dirs);
+
+private slots:
+    void onSearchFound(int gen, const SongRecord &r);
+    void onSearchNotFound(int gen);
+    void onSearchIndexChanged(qint64 bytes);
+    void onLibraryChanged(const QStringList &dirs);
+    void onUpdateFinished();
+
 protected:
     void run();
 
 private:
     void createIndex();
-    void dropIndex();
+    void createKeyColumns();
+    void createAnalysisColumns();
+    void createFilesTable(QSqlDatabase &conn);
+
+    void setPragmas(QSqlDatabase &conn);
+    void createSearchIndex();
+    void rebuildSearchIndex();
+
+    QHash<QString, FileStamp> indexedFiles(QSqlDatabase &conn);
+    void emitProgress(LibraryIndexer *indexer, const QString &fileName);
+
+    void updateWatchRoots();
+    void checkReindex();
+    // on the update thread, with the connection run() opened
+    void updateAll(QSqlDatabase &conn);
+    void updateChanged(QSqlDatabase &conn);
+    // writes songs and files for the full and the watcher update
+    void writeResults(QSqlDatabase &conn, LibraryIndexer *indexer, bool progress, qint64 settleAfter,
+                      QList<qint64> *removedRows, QList<qint64> *addedRows, QStringList *unsettled);
 
 private:
     QSqlDatabase db;
@@ -95,9 +156,38 @@ private:
 
 
     int upCount = 0;
+    int upPosition = 0;
     bool upTing = false;
 
-    int currentResultIndex = -1;
+    SearchWorker *searcher;
+    QThread searchThread;
+    int searchGen = 0;
+    int answeredGen = 0;
+    bool songFound = false;
+    qint64 indexBytes = 0;
+
+    LibraryWatcher *watcher;
+    bool watchEnabled = false;
+    // waiting for the next UpdateChanged run
+    std::mutex changedMutex;
+    QSet<QString> changedDirs;
+    // asked for while an UpdateChanged run was going
+    bool pendingFullUpdate = false;
+    // files was emptied for the analysis columns, the watcher has nothing to compare with
+    bool reindexNeeded = false;
+
+    // trigram full-text index, off when sqlite is built without it
+    bool useFts = false;
+
+    // the update thread's own connection, db belongs to the gui thread
+    const QString UPDATE_CONNECTION = "update";
+
+    const int WRITE_BATCH_SIZE = 2000;
+    // the longest a batch holds the write lock while the workers parse
+    const int COMMIT_INTERVAL_MS = 250;
+    const int PROGRESS_INTERVAL_MS = 100;
+    // a file modified this recently may still be copying
+    const int SETTLE_MS = 2000;
 };
 
 #endif // SONGDATABASE_H
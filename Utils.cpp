@@ -2,12 +2,12 @@
 
 #include <thread>
 
-#include <QDataStream>
 #include <QTextStream>
 #include <QProcess>
 #include <QDir>
 
 #include "Config.h"
+#include "NCNDecoder.h"
 #include "Midi/MidiHelper.h"
 
 Utils::Utils()
@@ -15,73 +15,32 @@ Utils::Utils()
 
 }
 
-QList<long> Utils::readCurFile(const QString &curFile, uint32_t resolution)
+QVector<long> Utils::readCurFile(const QString &curFile, uint32_t resolution)
 {
-    QList<long> curs;
     QFile f(curFile);
-    f.open(QIODevice::ReadOnly);
-
-    QDataStream in(&f);
-    while (!in.atEnd()) {
-        quint8 b1 = 0;
-        quint8 b2 = 0;
-        in >> b1;
-        in >> b2;
-        long cs = (b1 + (b2 << 8)) * resolution / 24;
-        curs.append(cs);
-    }
-    f.close();
-    return curs;
+    if (!f.open(QIODevice::ReadOnly))
+        return QVector<long>();
+
+    return NCNDecoder::cursorTicks(f.readAll(), resolution);
 }
 
-QList<long> Utils::readCurFile(const QByteArray &data, uint32_t resolution)
+QVector<long> Utils::readCurFile(const QByteArray &data, uint32_t resolution)
 {
-    QList<long> curs;
-    QDataStream in(data);
-    while (!in.atEnd()) {
-        quint8 b1 = 0;
-        quint8 b2 = 0;
-        in >> b1;
-        in >> b2;
-        long cs = (b1 + (b2 << 8)) * resolution / 24;
-        curs.append(cs);
-    }
-    return curs;
+    return NCNDecoder::cursorTicks(data, resolution);
 }
 
 QString Utils::readLyrics(const QString &lyrFile)
 {
     QFile f(lyrFile);
-    f.open(QIODevice::ReadOnly);
-
-    QTextStream textStream(&f);
-    textStream.setCodec("TIS-620");
-
-    textStream.readLine();
-    textStream.readLine();
-    textStream.readLine();
-    textStream.readLine();
+    if (!f.open(QIODevice::ReadOnly))
+        return QString("");
 
-    QString lyr = textStream.readAll();
-
-    f.close();
-
-    return lyr;
+    return NCNDecoder::lyrText(f.readAll());
 }
 
 QString Utils::readLyrics(const QByteArray &data)
 {
-    QTextStream textStream(data);
-    textStream.setCodec("TIS-620");
-
-    textStream.readLine();
-    textStream.readLine();
-    textStream.readLine();
-    textStream.readLine();
-
-    QString lyr = textStream.readAll();
-
-    return lyr;
+    return NCNDecoder::lyrText(data);
 }
 
 uint Utils::concurentThreadsSupported()
@@ -4,6 +4,7 @@
 #include <QFile>
 #include <QMenu>
 #include <QSignalMapper>
+#include <QVector>
 
 #include "Song.h"
 #include "Midi/MidiSynthesizer.h"
@@ -18,8 +19,8 @@ class Utils
 public:
     Utils();
 
-    static QList<long> readCurFile(const QString &curFile, uint32_t resolution);
-    static QList<long> readCurFile(const QByteArray &data, uint32_t resolution);
+    static QVector<long> readCurFile(const QString &curFile, uint32_t resolution);
+    static QVector<long> readCurFile(const QByteArray &data, uint32_t resolution);
 
     static QString readLyrics(const QString &lyrFile);
     static QString readLyrics(const QByteArray &data);
@@ -0,0 +1,454 @@
+#include "LyricsRenderer.h"
+
+#include <QGlyphRun>
+#include <QHash>
+#include <QPainter>
+#include <QPainterPath>
+#include <QRawFont>
+#include <QSet>
+#include <QTextLayout>
+#include <QThread>
+
+#include <climits>
+#include <mutex>
+
+
+namespace {
+
+typedef struct
+{
+    QSize size;
+    int pointSize;
+    LineImages images;
+} SharedLine;
+
+std::mutex sharedMutex;
+QHash<QString, QList<SharedLine>> sharedLines;    // style key -> sizes
+QStringList sharedOrder;
+
+// a few songs worth of lines for every view
+const int SHARED_LINES = 64;
+
+// a view smaller than this is drawn again, borders get too thin
+const double MIN_SCALE = 0.5;
+
+QThread *renderThread = nullptr;
+int renderUsers = 0;
+
+// the three layers of a glyph as alpha masks, the color comes at the blit
+typedef struct
+{
+    QPoint offset;      // of the masks from the pen position
+    QImage outer;
+    QImage border;
+    QImage fill;
+} GlyphMasks;
+
+typedef struct
+{
+    QHash<quint32, GlyphMasks> glyphs;
+    qint64 bytes;
+} GlyphFont;
+
+typedef struct
+{
+    QPoint pos;
+    GlyphMasks masks;
+} PlacedGlyph;
+
+std::mutex glyphMutex;
+QHash<QString, GlyphFont> glyphFonts;   // font, size and borders -> glyphs
+QStringList glyphOrder;
+
+// the fonts of both color sets for a few sizes, large 4K glyphs are big
+const int GLYPH_FONTS = 8;
+const qint64 GLYPH_BYTES = 64 * 1024 * 1024;
+
+qint64 maskBytes(const QImage &mask)
+{
+    return static_cast<qint64>(mask.bytesPerLine()) * mask.height();
+}
+
+QImage glyphMask(const QPainterPath &path, const QRect &rect, int penWidth)
+{
+    QImage img(rect.size(), QImage::Format_ARGB32_Premultiplied);
+    img.fill(Qt::transparent);
+
+    QPainter p(&img);
+    p.setRenderHints(QPainter::Antialiasing);
+    p.translate(-rect.topLeft());
+
+    // the same pen and brush as the path painting
+    if (penWidth > 0)
+        p.setPen(QPen(Qt::black, penWidth, Qt::SolidLine, Qt::SquareCap, Qt::RoundJoin));
+    else
+        p.setPen(Qt::NoPen);
+    p.setBrush(Qt::black);
+    p.drawPath(path);
+    p.end();
+
+    return img.convertToFormat(QImage::Format_Alpha8);
+}
+
+GlyphMasks makeGlyph(const QPainterPath &path, const LineColors &c)
+{
+    GlyphMasks g;
+
+    int pad = (c.borderWidth + c.borderOutWidth) / 2 + 2;
+    QRect rect = path.boundingRect().toAlignedRect().adjusted(-pad, -pad, pad, pad);
+    g.offset = rect.topLeft();
+
+    if (path.isEmpty())
+        return g;
+
+    if (c.borderOutWidth > 0)
+        g.outer = glyphMask(path, rect, c.borderOutWidth + c.borderWidth);
+    if (c.borderWidth > 0)
+        g.border = glyphMask(path, rect, c.borderWidth);
+    g.fill = glyphMask(path, rect, 0);
+
+    return g;
+}
+
+QString glyphFontKey(const QRawFont &font, const LineColors &c)
+{
+    return QString("%1\n%2\n%3 %4 %5 %6").arg(font.familyName()).arg(font.styleName())
+            .arg(font.pixelSize()).arg(font.weight()).arg(c.borderWidth).arg(c.borderOutWidth);
+}
+
+// the glyphs of a line with their masks, made once for each font. New
+// masks are rasterised without the lock, the GUI thread may be waiting
+// on it for a line that was not drawn ahead.
+QList<PlacedGlyph> placeGlyphs(const QList<QGlyphRun> &runs, const LineColors &c, const QPointF &origin)
+{
+    QList<PlacedGlyph> placed;
+
+    for (const QGlyphRun &run : runs) {
+        QRawFont font = run.rawFont();
+        QString key = glyphFontKey(font, c);
+
+        QVector<quint32> indexes = run.glyphIndexes();
+        QVector<QPointF> positions = run.positions();
+
+        QHash<quint32, GlyphMasks> masks;
+        QSet<quint32> missing;
+
+        {
+            std::lock_guard<std::mutex> lock(glyphMutex);
+
+            QHash<QString, GlyphFont>::const_iterator f = glyphFonts.constFind(key);
+            for (quint32 index : indexes) {
+                if (masks.contains(index) || missing.contains(index))
+                    continue;
+
+                if (f != glyphFonts.constEnd() && f->glyphs.contains(index))
+                    masks.insert(index, f->glyphs.value(index));
+                else
+                    missing.insert(index);
+            }
+        }
+
+        QHash<quint32, GlyphMasks> made;
+        for (quint32 index : missing)
+            made.insert(index, makeGlyph(font.pathForGlyph(index), c));
+
+        if (!made.isEmpty()) {
+            std::lock_guard<std::mutex> lock(glyphMutex);
+
+            if (!glyphFonts.contains(key)) {
+                GlyphFont gf;
+                gf.bytes = 0;
+                glyphFonts.insert(key, gf);
+                glyphOrder << key;
+
+                while (glyphOrder.count() > GLYPH_FONTS)
+                    glyphFonts.remove(glyphOrder.takeFirst());
+            }
+
+            GlyphFont &gf = glyphFonts[key];
+
+            for (QHash<quint32, GlyphMasks>::const_iterator it = made.constBegin(); it != made.constEnd(); ++it) {
+                masks.insert(it.key(), it.value());
+
+                // the other thread may have made it meanwhile
+                if (gf.glyphs.contains(it.key()))
+                    continue;
+
+                const GlyphMasks &g = it.value();
+                gf.bytes += maskBytes(g.outer) + maskBytes(g.border) + maskBytes(g.fill);
+                gf.glyphs.insert(it.key(), g);
+            }
+
+            // a huge font starts over, the masks of this line are still held
+            if (gf.bytes > GLYPH_BYTES) {
+                gf.glyphs.clear();
+                gf.bytes = 0;
+            }
+        }
+
+        for (int i=0; i<indexes.count(); i++) {
+            PlacedGlyph pg;
+            pg.pos = (origin + positions.at(i)).toPoint();
+            pg.masks = masks.value(indexes.at(i));
+            placed << pg;
+        }
+    }
+
+    return placed;
+}
+
+// every layer of all the glyphs is tinted once, the outer border of a
+// glyph never covers the fill of its neighbour, like the stroked path
+QImage composeLine(const QSize &size, const QList<PlacedGlyph> &glyphs, const LineColors &c)
+{
+    QImage line(size, QImage::Format_ARGB32_Premultiplied);
+    line.fill(Qt::transparent);
+
+    QImage layer(size, QImage::Format_ARGB32_Premultiplied);
+
+    QPainter lp(&line);
+
+    for (int l=0; l<3; l++) {
+        QColor color = l == 0 ? c.borderOutColor : (l == 1 ? c.borderColor : c.color);
+        if ((l == 0 && c.borderOutWidth <= 0) || (l == 1 && c.borderWidth <= 0))
+            continue;
+
+        layer.fill(Qt::transparent);
+
+        QPainter p(&layer);
+        for (const PlacedGlyph &g : glyphs) {
+            const QImage &mask = l == 0 ? g.masks.outer : (l == 1 ? g.masks.border : g.masks.fill);
+            if (!mask.isNull())
+                p.drawImage(g.pos + g.masks.offset, mask);
+        }
+
+        p.setCompositionMode(QPainter::CompositionMode_SourceIn);
+        p.fillRect(layer.rect(), color);
+        p.end();
+
+        lp.drawImage(0, 0, layer);
+    }
+
+    lp.end();
+
+    return line;
+}
+
+QString colorsKey(const LineColors &c)
+{
+    return QString("%1 %2 %3 %4 %5").arg(c.color.rgba()).arg(c.borderColor.rgba())
+            .arg(c.borderOutColor.rgba()).arg(c.borderWidth).arg(c.borderOutWidth);
+}
+
+// everything but the size
+QString styleKey(const LineJob &job)
+{
+    QFont f = job.font;
+    f.setPointSize(1);
+
+    return f.key() + QLatin1Char('\n') + colorsKey(job.plain) + QLatin1Char('\n')
+            + colorsKey(job.cursor) + QLatin1Char('\n') + job.text;
+}
+
+} // namespace
+
+
+LyricsRenderer::LyricsRenderer()
+{
+    latest = 0;
+}
+
+LyricsRenderer *LyricsRenderer::create()
+{
+    if (renderThread == nullptr) {
+        renderThread = new QThread();
+        renderThread->start(QThread::LowPriority);
+    }
+
+    renderUsers++;
+
+    LyricsRenderer *renderer = new LyricsRenderer();
+    renderer->moveToThread(renderThread);
+
+    return renderer;
+}
+
+void LyricsRenderer::release(LyricsRenderer *renderer)
+{
+    renderer->setGeneration(-1);
+    renderer->deleteLater();
+
+    if (--renderUsers > 0)
+        return;
+
+    // the deferred delete runs when the thread finishes
+    renderThread->quit();
+    renderThread->wait();
+    delete renderThread;
+    renderThread = nullptr;
+}
+
+void LyricsRenderer::paintLine(QPaintDevice *device, const QString &text, const QFont &f, int x, const LineColors &c)
+{
+    QPainter p(device);
+    p.setRenderHints(QPainter::Antialiasing);
+
+    QPainterPath path;
+    path.addText(x, f.pointSize() * 2, f, text);
+
+    if (c.borderOutWidth > 0) {
+        int w = c.borderOutWidth + c.borderWidth;
+        QPen pen(c.borderOutColor, w, Qt::SolidLine, Qt::SquareCap, Qt::RoundJoin);
+        p.setPen(pen);
+        p.setBrush(c.borderOutColor);
+        p.drawPath(path);
+    }
+
+    if (c.borderWidth > 0) {
+        int w = c.borderWidth;
+        QPen pen(c.borderColor, w, Qt::SolidLine, Qt::SquareCap, Qt::RoundJoin);
+        p.setPen(pen);
+        p.setBrush(c.borderColor);
+        p.drawPath(path);
+    }
+
+    p.setPen(Qt::NoPen);
+    p.fillPath(path, c.color);
+
+    p.end();
+}
+
+LineImages LyricsRenderer::renderLine(const LineJob &job)
+{
+    LineImages images;
+
+    // shaped like addText, thai marks are glyphs placed on their consonant
+    QTextLayout layout(job.text, job.font);
+    QTextOption option;
+    option.setWrapMode(QTextOption::NoWrap);
+    layout.setTextOption(option);
+
+    layout.beginLayout();
+    QTextLine line = layout.createLine();
+    if (line.isValid()) {
+        line.setLineWidth(INT_MAX / 2);
+        line.setPosition(QPointF(0, 0));
+    }
+    layout.endLayout();
+
+    QList<QGlyphRun> runs = line.isValid() ? layout.glyphRuns() : QList<QGlyphRun>();
+    if (!runs.isEmpty() || job.text.trimmed().isEmpty()) {
+        // the baseline of addText is at twice the point size
+        QPointF origin(job.x, line.isValid() ? job.font.pointSize() * 2 - line.ascent() : 0);
+
+        images.plain = composeLine(job.size, placeGlyphs(runs, job.plain, origin), job.plain);
+        images.cursor = composeLine(job.size, placeGlyphs(runs, job.cursor, origin), job.cursor);
+        return images;
+    }
+
+    images.plain = QImage(job.size, QImage::Format_ARGB32_Premultiplied);
+    images.plain.fill(Qt::transparent);
+    paintLine(&images.plain, job.text, job.font, job.x, job.plain);
+
+    images.cursor = QImage(job.size, QImage::Format_ARGB32_Premultiplied);
+    images.cursor.fill(Qt::transparent);
+    paintLine(&images.cursor, job.text, job.font, job.x, job.cursor);
+
+    return images;
+}
+
+LineImages LyricsRenderer::lineImages(const LineJob &job)
+{
+    LineImages images;
+    if (findShared(job, &images))
+        return images;
+
+    images = renderLine(job);
+    share(job, images);
+
+    return images;
+}
+
+bool LyricsRenderer::findShared(const LineJob &job, LineImages *images)
+{
+    std::lock_guard<std::mutex> lock(sharedMutex);
+
+    QHash<QString, QList<SharedLine>>::const_iterator it = sharedLines.constFind(styleKey(job));
+    if (it == sharedLines.constEnd())
+        return false;
+
+    const SharedLine *larger = nullptr;
+    for (const SharedLine &line : it.value()) {
+        if (line.size == job.size && line.pointSize == job.font.pointSize()) {
+            *images = line.images;
+            return true;
+        }
+
+        if (line.size.width() >= job.size.width() && line.size.height() >= job.size.height()
+                && job.size.height() >= line.size.height() * MIN_SCALE
+                && (larger == nullptr || line.size.height() < larger->size.height()))
+            larger = &line;
+    }
+
+    if (larger == nullptr)
+        return false;
+
+    // a second screen of another size, scaling is cheaper than the paths
+    images->plain = larger->images.plain.scaled(job.size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    images->cursor = larger->images.cursor.scaled(job.size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+
+    return true;
+}
+
+void LyricsRenderer::share(const LineJob &job, const LineImages &images)
+{
+    std::lock_guard<std::mutex> lock(sharedMutex);
+
+    SharedLine line;
+    line.size = job.size;
+    line.pointSize = job.font.pointSize();
+    line.images = images;
+
+    QString key = styleKey(job);
+    QList<SharedLine> &sizes = sharedLines[key];
+    if (sizes.isEmpty())
+        sharedOrder << key;
+
+    // both views may have drawn it at the same time
+    for (const SharedLine &l : sizes) {
+        if (l.size == line.size && l.pointSize == line.pointSize)
+            return;
+    }
+    sizes << line;
+
+    while (sharedOrder.count() > SHARED_LINES)
+        sharedLines.remove(sharedOrder.takeFirst());
+}
+
+qint64 LyricsRenderer::imagesBytes(const LineImages &images)
+{
+    return static_cast<qint64>(images.plain.bytesPerLine()) * images.plain.height()
+            + static_cast<qint64>(images.cursor.bytesPerLine()) * images.cursor.height();
+}
+
+qint64 LyricsRenderer::sharedBytes()
+{
+    std::lock_guard<std::mutex> lock(sharedMutex);
+
+    qint64 total = 0;
+    for (const QList<SharedLine> &sizes : sharedLines) {
+        for (const SharedLine &line : sizes)
+            total += imagesBytes(line.images);
+    }
+
+    return total;
+}
+
+void LyricsRenderer::render(int gen, const LineJob &job)
+{
+    // the song or the style changed while this was queued
+    if (gen != latest)
+        return;
+
+    emit rendered(gen, job.text, lineImages(job));
+}
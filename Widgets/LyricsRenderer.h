@@ -0,0 +1,78 @@
+#ifndef LYRICSRENDERER_H
+#define LYRICSRENDERER_H
+
+#include <QColor>
+#include <QFont>
+#include <QImage>
+#include <QObject>
+#include <QSize>
+
+#include <atomic>
+
+// fill and the two borders of a lyric line, plain or under the cursor
+typedef struct
+{
+    QColor color;
+    QColor borderColor;
+    QColor borderOutColor;
+    int borderWidth;
+    int borderOutWidth;
+} LineColors;
+
+// everything needed to draw a line, worked out on the GUI thread
+typedef struct
+{
+    QString text;
+    QFont font;         // already fitted to the widget
+    QSize size;
+    int x;              // the border size, the text starts after it
+    LineColors plain;
+    LineColors cursor;
+} LineJob;
+
+typedef struct
+{
+    QImage plain;
+    QImage cursor;
+} LineImages;
+
+// Draws lyric lines into QImages, painting a QImage is allowed
+// on any thread. Every LyricsWidget has one, they all run on one
+// render thread and share the drawn lines. A view of the same size
+// gets the same images, a smaller one gets them scaled down.
+class LyricsRenderer : public QObject
+{
+    Q_OBJECT
+public:
+    // a renderer on the shared thread, the thread stops with the last one
+    static LyricsRenderer *create();
+    static void release(LyricsRenderer *renderer);
+
+    static void paintLine(QPaintDevice *device, const QString &text, const QFont &f, int x, const LineColors &c);
+    // from the cached glyph masks, painting the paths when there are no glyphs
+    static LineImages renderLine(const LineJob &job);
+
+    // any thread, from the shared lines or drawn and shared
+    static LineImages lineImages(const LineJob &job);
+    static qint64 sharedBytes();
+    static qint64 imagesBytes(const LineImages &images);
+
+    // any thread, jobs of an older generation are skipped
+    void setGeneration(int gen) { latest = gen; }
+
+public slots:
+    void render(int gen, const LineJob &job);
+
+signals:
+    void rendered(int gen, const QString &text, const LineImages &images);
+
+private:
+    LyricsRenderer();
+
+    static bool findShared(const LineJob &job, LineImages *images);
+    static void share(const LineJob &job, const LineImages &images);
+
+    std::atomic<int> latest;
+};
+
+#endif // LYRICSRENDERER_H
@@ -1,12 +1,20 @@
 #include "LyricsWidget.h"
 
 #include <QPainter>
+#include <QResizeEvent>
+#include <QTextBoundaryFinder>
+#include <QTextLayout>
+
+#include <algorithm>
+#include <climits>
 
 
 LyricsWidget::LyricsWidget(QWidget *parent) : QWidget(parent)
 {
-    animation = new QVariantAnimation(this);
-    animation->setDuration(300);
+    renderer = LyricsRenderer::create();
+
+    connect(this, SIGNAL(renderRequested(int,LineJob)), renderer, SLOT(render(int,LineJob)));
+    connect(renderer, SIGNAL(rendered(int,QString,LineImages)), this, SLOT(onLineRendered(int,QString,LineImages)));
 
     QFont f = font();
     f.setBold(true);
@@ -27,56 +35,34 @@ LyricsWidget::LyricsWidget(QWidget *parent) : QWidget(parent)
 
     setLine1Y(220);
     setLine2Y(100);
-
-    connect(animation, SIGNAL(valueChanged(QVariant)),
-            this, SLOT(onAnimationValueChanged(QVariant)));
 }
 
 LyricsWidget::~LyricsWidget()
 {
-    animation->stop();
     cursors.clear();
     lyrics.clear();
+    timeline.clear();
 
-    delete animation;
+    LyricsRenderer::release(renderer);
 }
 
 void LyricsWidget::reset()
 {
-    animation->stop();
-
-    linesIndex = 0;
-    if (lyrics.count() > 0) {
-        tLine1 = lyrics.at(0);
-        setTextLine1(tLine1);
-        linesIndex = 1;
-    }
-    if (lyrics.count() > 1) {
-        tLine2 = lyrics.at(1);
-        setTextLine2(tLine2);
-    }
-
-    isLine1 = true;
-    cursor_toEnd = 0;
+    line1Index = -1;
+    line2Index = -1;
     cursor_width = 0;
-    cursor_index = 0;
-    char_index = -1;
-    at_end_line = false;
-
-    chars_width.clear();
-    chars_width = getCharsWidth(tLine1);
 
-    updateArea = calculateUpdateArea();
+    showLine(0);
 
     update();
 }
 
-void LyricsWidget::setLyrics(const QString &lyr, const QList<long> &curs)
+void LyricsWidget::setLyrics(const QString &lyr, const QVector<long> &curs, const QVector<long> &times)
 {
-    animation->stop();
-
     cursors.clear();
     lyrics.clear();
+    advanceCache.clear();
+    invalidatePrerender();
 
     if (lyr.length() > 0) {
         lyrics = lyr.split(QRegExp("\n|\r\n|\r"));
@@ -86,6 +72,7 @@ void LyricsWidget::setLyrics(const QString &lyr, const QList<long> &curs)
     }
 
     cursors = curs;
+    QVector<long> t = times.count() == curs.count() ? times : curs;
 
     // ค้นหา บรรทัดว่าง
     int index = 0;
@@ -101,201 +88,80 @@ void LyricsWidget::setLyrics(const QString &lyr, const QList<long> &curs)
 
         l = " ";
         cursors.insert(index, cursors[index]);
+        t.insert(index, t[index]);
         index++;
     }
 
+    buildTimeline(t);
+
     reset();
 }
 
 void LyricsWidget::setPositionCursor(int tick)
 {
-    if (cursor_index >= cursors.count())
-        return;
-
-    if (tick < cursors[cursor_index])
-        return;
-
-    if (at_end_line) {
-        at_end_line = false;
-        char_index = 0;
-        cursor_width = 0;
-        cursor_toEnd = 0;
-        isLine1 = !isLine1;
-    }
-
-    if (chars_width.count() == 0 && linesIndex < lyrics.count()) {
-        if (isLine1)
-            setTextLine2(lyrics.at(linesIndex));
-        else
-            setTextLine1(lyrics.at(linesIndex));
-        linesIndex++;
-        isLine1 = !isLine1;
-        cursor_index++;
-
-        chars_width.clear();
-        chars_width = getCharsWidth();
-
-        return;
-    }
-
-    if (char_index == chars_width.count()) {
-        animation->stop();
-        cursor_width = chars_width.last();
-        at_end_line = true;
-        cursor_index++;
-        update();
-
-        return;
-    }
-
-    if (char_index == 0) {
-        if (linesIndex < lyrics.count()) {
-            if (isLine1)
-                setTextLine2(lyrics.at(linesIndex));
-            else
-                setTextLine1(lyrics.at(linesIndex));
-            linesIndex++;
-        } else {
-            if (isLine1) setTextLine2("");
-            else setTextLine1("");
-        }
-
-        //update();
-
-        chars_width.clear();
-        chars_width = getCharsWidth();
-        updateArea = calculateUpdateArea();
-    }
-
-    if (char_index >= 0 && chars_width.count() != 0) {
-        cursor_toEnd = chars_width.at(char_index);
-    }
-
-    char_index++;
-
-    if (cursor_index == cursors.count() - 1) {
-        cursor_toEnd = chars_width.count() == 0 ? 0 : chars_width.last();
-    }
-
-    cursor_index++;
-
-    animation->stop();
-    animation->setStartValue(cursor_width);
-    animation->setEndValue(cursor_toEnd);
-    animation->start();
-
+    setPositionMs(msFromTick(tick));
 }
 
 void LyricsWidget::setSeekPositionCursor(int tick)
 {
-    animation->stop();
+    setPositionMs(msFromTick(tick));
+    update();
+}
 
-    if (tick == 0) {
-        reset();
-        return;
-    }
+void LyricsWidget::setPositionMs(long ms)
+{
+    if (timelineDirty)
+        layoutTimeline();
 
-    if (cursors.count() == 0) {
-        return;
-    }
+    // the last cursor reached, any number of them may have passed
+    QVector<LyricsTiming>::const_iterator it =
+            std::upper_bound(timeline.constBegin(), timeline.constEnd(), ms,
+                             [](long t, const LyricsTiming &e) { return t < e.start; });
 
-    reset();
+    int line = 0;
+    int width = 0;
 
-    int round = 0;
-    while (cursors[round] < tick) {
-        round++;
-        if (round == cursors.count())
-            break;
+    if (it != timeline.constBegin()) {
+        const LyricsTiming &e = *(it - 1);
+        line = e.line;
+        width = e.x1;
+        if (ms < e.end && e.end > e.start)
+            width = e.x0 + static_cast<int>(static_cast<qint64>(e.x1 - e.x0) * (ms - e.start) / (e.end - e.start));
     }
 
-    for (int i=0; i<round; i++) {
-
-        if (at_end_line) {
-            at_end_line = false;
-            char_index = 0;
-            cursor_width = 0;
-            cursor_toEnd = 0;
-            isLine1 = !isLine1;
-            //updateArea = calculateUpdateArea();
-        }
-
-        if (chars_width.count() == 0 && linesIndex < lyrics.count()) {
-            if (isLine1)
-                tLine2 = lyrics.at(linesIndex);
-            else
-                tLine1 = lyrics.at(linesIndex);
-            linesIndex++;
-            isLine1 = !isLine1;
-            cursor_index++;
-
-            chars_width.clear();
-            chars_width = getCharsWidth();
-            continue;
-        }
-
-        if (char_index == chars_width.count()) {
-            cursor_width = chars_width.last();
-            at_end_line = true;
-            cursor_index++;
-
-            /*if (linesIndex < lyrics.count()) {
-                if (isLine1)
-                    tLine1 = lyrics.at(linesIndex);
-                else
-                    tLine2 = lyrics.at(linesIndex);
-                linesIndex++;
-            } else {
-                if (isLine1) tLine1 = "";
-                else tLine2 = "";
-            }*/
-
-            continue;
-        }
-
-        if (char_index == 0) {
-            if (linesIndex < lyrics.count()) {
-                if (isLine1)
-                    tLine2 = lyrics.at(linesIndex);
-                else
-                    tLine1 = lyrics.at(linesIndex);
-                linesIndex++;
-            } else {
-                if (isLine1) tLine2 = "";
-                else tLine1 = "";
-            }
-            chars_width.clear();
-            chars_width = getCharsWidth();
-        }
-
-        if (char_index >= 0 && chars_width.count() != 0) {
-            cursor_toEnd = chars_width.at(char_index);
-        }
-
-        char_index++;
+    showLine(line);
 
-        if (cursor_index == cursors.count() - 1) {
-            cursor_toEnd = chars_width.count() == 0 ? 0 : chars_width.last();
-        }
-
-        cursor_index++;
+    if (width != cursor_width) {
+        cursor_width = width;
+        update(updateArea);
+    }
+}
 
-    } // end for loop
+qint64 LyricsWidget::cacheBytes()
+{
+    auto bytes = [](const QSize &s) { return static_cast<qint64>(s.width()) * s.height() * 4; };
 
-    at_end_line = (char_index == chars_width.count()) ? true : false;
-    chars_width.clear();
-    chars_width = getCharsWidth();
+    qint64 total = bytes(pixLine1.size()) + bytes(pixLine2.size())
+            + bytes(pixCurLine1.size()) + bytes(pixCurLine2.size());
+    for (const LineImages &images : prerendered)
+        total += LyricsRenderer::imagesBytes(images);
 
-    setTextLine1(tLine1);
-    setTextLine2(tLine2);
+    return total;
+}
 
-    updateArea = calculateUpdateArea();
-    cursor_width = cursor_toEnd;
-    update();
+QVector<long> LyricsWidget::curTimes()
+{
+    QVector<long> times;
+    times.reserve(timeline.count());
+    for (const LyricsTiming &e : timeline)
+        times.append(e.start);
+    return times;
 }
 
 void LyricsWidget::setTextFont(const QFont &f)
 {
     setFont(f);
+    invalidatePrerender();
 
     setTextLine1(tLine1);
     setTextLine2(tLine2);
@@ -306,6 +172,7 @@ void LyricsWidget::setTextFont(const QFont &f)
 void LyricsWidget::setTextColor(const QColor &c)
 {
     tColor = c;
+    invalidatePrerender();
     setTextLine1(tLine1);
     setTextLine2(tLine2);
 }
@@ -313,6 +180,7 @@ void LyricsWidget::setTextColor(const QColor &c)
 void LyricsWidget::setTextBorderColor(const QColor &c)
 {
     tBorderColor = c;
+    invalidatePrerender();
     setTextLine1(tLine1);
     setTextLine2(tLine2);
 }
@@ -320,6 +188,7 @@ void LyricsWidget::setTextBorderColor(const QColor &c)
 void LyricsWidget::setTextBorderOutColor(const QColor &c)
 {
     tBorderOutColor = c;
+    invalidatePrerender();
     setTextLine1(tLine1);
     setTextLine2(tLine2);
 }
@@ -327,6 +196,7 @@ void LyricsWidget::setTextBorderOutColor(const QColor &c)
 void LyricsWidget::setTextBorderWidth(int w)
 {
     tBorderWidth = w;
+    invalidatePrerender();
     setTextLine1(tLine1);
     setTextLine2(tLine2);
     updateArea = calculateUpdateArea();
@@ -335,6 +205,7 @@ void LyricsWidget::setTextBorderWidth(int w)
 void LyricsWidget::setTextBorderOutWidth(int w)
 {
     tBorderOutWidth = w;
+    invalidatePrerender();
     setTextLine1(tLine1);
     setTextLine2(tLine2);
     updateArea = calculateUpdateArea();
@@ -343,6 +214,7 @@ void LyricsWidget::setTextBorderOutWidth(int w)
 void LyricsWidget::setCurColor(const QColor &c)
 {
     cColor = c;
+    invalidatePrerender();
     setTextLine1(tLine1);
     setTextLine2(tLine2);
 }
@@ -350,6 +222,7 @@ void LyricsWidget::setCurColor(const QColor &c)
 void LyricsWidget::setCurBorderColor(const QColor &c)
 {
     cBorderColor = c;
+    invalidatePrerender();
     setTextLine1(tLine1);
     setTextLine2(tLine2);
 }
@@ -357,6 +230,7 @@ void LyricsWidget::setCurBorderColor(const QColor &c)
 void LyricsWidget::setCurBorderOutColor(const QColor &c)
 {
     cBorderOutColor = c;
+    invalidatePrerender();
     setTextLine1(tLine1);
     setTextLine2(tLine2);
 }
@@ -364,6 +238,7 @@ void LyricsWidget::setCurBorderOutColor(const QColor &c)
 void LyricsWidget::setCurBorderWidth(int w)
 {
     cBorderWidth = w;
+    invalidatePrerender();
     setTextLine1(tLine1);
     setTextLine2(tLine2);
     updateArea = calculateUpdateArea();
@@ -372,6 +247,7 @@ void LyricsWidget::setCurBorderWidth(int w)
 void LyricsWidget::setCurBorderOutWidth(int w)
 {
     cBorderOutWidth = w;
+    invalidatePrerender();
     setTextLine1(tLine1);
     setTextLine2(tLine2);
     updateArea = calculateUpdateArea();
@@ -379,12 +255,8 @@ void LyricsWidget::setCurBorderOutWidth(int w)
 
 void LyricsWidget::setAnimationTime(int t)
 {
-    if (t < 100)
-         animation->setDuration(100);
-    else if (t > 500)
-        animation->setDuration(500);
-    else
-        animation->setDuration(t);
+    wipeTime = qBound(100, t, 500);
+    updateEnds();
 }
 
 void LyricsWidget::setLine1Position(LinePosition p)
@@ -425,11 +297,12 @@ void LyricsWidget::setTextLine1(const QString &text, bool andUpdate)
 {
     tLine1 = text;
 
-    pixLine1 = QPixmap(calculateLineSize(text));
-    drawTextToPixmap(&pixLine1, text);
+    // not drawn ahead yet, it may be shared by another view
+    QHash<QString, LineImages>::const_iterator it = prerendered.constFind(text);
+    LineImages images = it != prerendered.constEnd() ? it.value() : LyricsRenderer::lineImages(lineJob(text));
 
-    pixCurLine1 = QPixmap(pixLine1.size());
-    drawCursorTextToPixmap(&pixCurLine1, text);
+    pixLine1 = QPixmap::fromImage(images.plain);
+    pixCurLine1 = QPixmap::fromImage(images.cursor);
 
     if (andUpdate)
         update();
@@ -439,11 +312,12 @@ void LyricsWidget::setTextLine2(const QString &text, bool andUpdate)
 {
     tLine2 = text;
 
-    pixLine2 = QPixmap(calculateLineSize(text));
-    drawTextToPixmap(&pixLine2, text);
+    // not drawn ahead yet, it may be shared by another view
+    QHash<QString, LineImages>::const_iterator it = prerendered.constFind(text);
+    LineImages images = it != prerendered.constEnd() ? it.value() : LyricsRenderer::lineImages(lineJob(text));
 
-    pixCurLine2 = QPixmap(pixLine2.size());
-    drawCursorTextToPixmap(&pixCurLine2, text);
+    pixLine2 = QPixmap::fromImage(images.plain);
+    pixCurLine2 = QPixmap::fromImage(images.cursor);
 
     if (andUpdate)
         update();
@@ -451,6 +325,11 @@ void LyricsWidget::setTextLine2(const QString &text, bool andUpdate)
 
 void LyricsWidget::resizeEvent(QResizeEvent *event)
 {
+    if (autoFontSize && event->size().width() != event->oldSize().width()) {
+        invalidatePrerender();
+        prerenderAhead();
+    }
+
     update();
     updateArea = calculateUpdateArea();
 }
@@ -493,33 +372,68 @@ void LyricsWidget::paintEvent(QPaintEvent *event)
     p.end();
 }
 
-void LyricsWidget::onAnimationValueChanged(const QVariant &v)
+void LyricsWidget::onLineRendered(int gen, const QString &text, const LineImages &images)
 {
-    cursor_width = v.toInt();
-    update(updateArea);
+    // a job of an old style or a line already out of the window
+    if (gen != renderGen || !prerendering.remove(text))
+        return;
+
+    prerendered.insert(text, images);
 }
 
-QList<int> LyricsWidget::getCharsWidth()
+QList<int> LyricsWidget::getCharsWidth(const QString &text)
 {
-    if (isLine1)
-        return getCharsWidth(tLine1);
-    else
-        return getCharsWidth(tLine2);
+    QFont f = autoFontSize ? getPerfectFont(text) : font();
+    QList<int> cl = getCharsAdvance(f, text);
+
+    int border = getAllBorderSize();
+    for (int &w : cl)
+        w += border;
+
+    if (cl.count() > 0)
+        cl.last() += border;
+
+    return cl;
 }
 
-QList<int> LyricsWidget::getCharsWidth(const QString &text)
+QList<int> LyricsWidget::getCharsAdvance(const QFont &f, const QString &text)
 {
+    QString key = f.key() + QLatin1Char('\n') + text;
+
+    QHash<QString, QList<int>>::const_iterator it = advanceCache.constFind(key);
+    if (it != advanceCache.constEnd())
+        return it.value();
+
+    // the whole line is shaped once, the x after every character comes from it
+    QTextLayout layout(text, f);
+    QTextOption option;
+    option.setWrapMode(QTextOption::NoWrap);
+    layout.setTextOption(option);
+
+    layout.beginLayout();
+    QTextLine line = layout.createLine();
+    if (line.isValid())
+        line.setLineWidth(INT_MAX / 2);
+    layout.endLayout();
+
+    // thai vowels and tone marks above or below are in the cluster
+    // of their consonant, they don't move the cursor
+    QTextBoundaryFinder graphemes(QTextBoundaryFinder::Grapheme, text);
+
     QList<int> cl;
-    QFont f = autoFontSize ? getPerfectFont(text) : font();
-    QFontMetrics m(f);
+    cl.reserve(text.length());
 
+    int x = 0;
     for (int i=0; i<text.length(); i++) {
-        int w = m.width(text.left(i+1)) + getAllBorderSize();
-        cl.append(w);
+        graphemes.setPosition(i + 1);
+        if (line.isValid() && graphemes.isAtBoundary())
+            x = qRound(line.cursorToX(i + 1));
+        cl.append(x);
     }
 
-    if (cl.count() > 0)
-        cl.last() += getAllBorderSize();
+    if (advanceCache.count() >= ADVANCE_CACHE_SIZE)
+        advanceCache.clear();
+    advanceCache.insert(key, cl);
 
     return cl;
 }
@@ -569,11 +483,65 @@ int LyricsWidget::getAllBorderSize()
 QFont LyricsWidget::getPerfectFont(const QString &text)
 {
     QFont f = font();
-    QFontMetrics m(f);
-    while (m.width(text) > this->width() - (getAllBorderSize() * 2)) {
-        f.setPointSize(f.pointSize() - 2);
-        m = QFontMetrics(f);
+    int size = f.pointSize();
+    int avail = this->width() - (getAllBorderSize() * 2);
+
+    if (size <= 1)
+        return f;
+
+    // the sizes are good for this width and font only
+    QString fontKey = f.key();
+    if (avail != fitWidth || fontKey != fitFontKey) {
+        fitSizes.clear();
+        fitWidth = avail;
+        fitFontKey = fontKey;
+    }
+
+    QHash<QString, int>::const_iterator it = fitSizes.constFind(text);
+    if (it != fitSizes.constEnd()) {
+        f.setPointSize(it.value());
+        return f;
     }
+
+    auto widthAt = [&](int s) {
+        QFont t = f;
+        t.setPointSize(s);
+        return QFontMetrics(t).width(text);
+    };
+
+    int w = QFontMetrics(f).width(text);
+
+    if (w > avail) {
+        // the width grows with the size, the largest size that fits is
+        // searched from the proportional estimate, usually it is right
+        int lo = 1;
+        int hi = size - 1;
+
+        int guess = qBound(lo, static_cast<int>(static_cast<qint64>(size) * qMax(avail, 0) / w), hi);
+        if (widthAt(guess) <= avail) {
+            lo = guess;
+            if (guess < hi && widthAt(guess + 1) > avail)
+                hi = guess;
+        } else {
+            hi = qMax(lo, guess - 1);
+        }
+
+        while (lo < hi) {
+            int mid = (lo + hi + 1) / 2;
+            if (widthAt(mid) <= avail)
+                lo = mid;
+            else
+                hi = mid - 1;
+        }
+
+        size = lo;
+    }
+
+    if (fitSizes.count() >= ADVANCE_CACHE_SIZE)
+        fitSizes.clear();
+    fitSizes.insert(text, size);
+
+    f.setPointSize(size);
     return f;
 }
 
@@ -623,102 +591,195 @@ QPoint LyricsWidget::getLine2Point()
     return p;
 }
 
-void LyricsWidget::drawTextToPixmap(QPixmap *pix, const QString &text)
+void LyricsWidget::buildTimeline(const QVector<long> &times)
 {
-    pix->fill(Qt::transparent);
-    QPainter p(pix);
-    p.setRenderHints(QPainter::Antialiasing);
+    timeline.clear();
+    timeline.reserve(cursors.count());
 
-    QFont f = autoFontSize ? getPerfectFont(text) : font();
-    QPainterPath path;
-    path.addText(getAllBorderSize(), f.pointSize() * 2, f, text);
-
-    if (tBorderOutWidth > 0) {
-        int w = tBorderOutWidth + tBorderWidth;
-        QPen pen(tBorderOutColor, w, Qt::SolidLine, Qt::SquareCap, Qt::RoundJoin);
-        p.setPen(pen);
-        p.setBrush(tBorderOutColor);
-        p.drawPath(path);
-    }
+    // a line has a cursor where it starts and one for each character,
+    // until the first character the previous line stays highlighted
+    int k = 0;
+    long tick = LONG_MIN, start = LONG_MIN;
+    for (int l=0; l<lyrics.count() && k<cursors.count(); l++) {
+        for (int c=-1; c<lyrics.at(l).length() && k<cursors.count(); c++, k++) {
+            // a cursor earlier than the one before waits for it
+            tick = qMax(tick, cursors.at(k));
+            start = qMax(start, times.at(k));
 
-    if (tBorderWidth > 0) {
-        int w = tBorderWidth;
-        QPen pen(tBorderColor, w, Qt::SolidLine, Qt::SquareCap, Qt::RoundJoin);
-        p.setPen(pen);
-        p.setBrush(tBorderColor);
-        p.drawPath(path);
+            LyricsTiming e;
+            e.line = l;
+            e.ch = c;
+            if (c < 0 && l > 0) {
+                e.line = l - 1;
+                e.ch = lyrics.at(l - 1).length();
+            }
+            e.tick = tick;
+            e.start = start;
+            e.end = start;
+            e.x0 = 0;
+            e.x1 = 0;
+            timeline.append(e);
+        }
     }
 
-    //p.setBrush(tColor);
-    p.setPen(Qt::NoPen);
+    updateEnds();
+    layoutTimeline();
+}
 
-    //p.drawPath(path);
-    p.fillPath(path, tColor);
+void LyricsWidget::layoutTimeline()
+{
+    timelineDirty = false;
 
-    /*if (tBorderWidth > 0) {
+    int line = -1;
+    QList<int> widths;
 
-        QPen pen(Qt::red, tBorderWidth * 2, Qt::SolidLine, Qt::SquareCap, Qt::RoundJoin);
-        QPainterPathStroker stroker(pen);
-        QPainterPath strokedPath = stroker.createStroke(path);
+    for (LyricsTiming &e : timeline) {
+        if (e.line != line) {
+            line = e.line;
+            widths = getCharsWidth(lyrics.at(line));
+        }
 
-        if (tBorderOutWidth > 0)
-            p.setPen(QPen(tBorderOutColor, tBorderOutWidth));
-        p.setBrush(tBorderColor);
-        p.drawPath(strokedPath.subtracted(path));
+        if (e.ch < 0) {
+            e.x0 = e.x1 = 0;
+        } else if (e.ch < widths.count()) {
+            e.x0 = e.ch == 0 ? 0 : widths.at(e.ch - 1);
+            e.x1 = widths.at(e.ch);
+        } else {
+            e.x0 = e.x1 = widths.isEmpty() ? 0 : widths.last();
+        }
+    }
+}
+
+void LyricsWidget::updateEnds()
+{
+    // a character is wiped until the next cursor, a held one not slower than the wipe time
+    for (int i=0; i<timeline.count(); i++) {
+        LyricsTiming &e = timeline[i];
+        e.end = e.start + wipeTime;
+        if (i + 1 < timeline.count())
+            e.end = qMin(e.end, timeline.at(i + 1).start);
+    }
+}
 
-        //QPen pen(tBorderColor, tBorderWidth * 2, Qt::SolidLine, Qt::SquareCap, Qt::RoundJoin);
-        //p.strokePath(path, pen);
-    }*/
+long LyricsWidget::msFromTick(long tick)
+{
+    if (timeline.isEmpty())
+        return tick;
 
-    p.end();
+    QVector<LyricsTiming>::const_iterator it =
+            std::upper_bound(timeline.constBegin(), timeline.constEnd(), tick,
+                             [](long t, const LyricsTiming &e) { return t < e.tick; });
+
+    if (it == timeline.constBegin())
+        return timeline.first().start - 1;
+
+    // the cursors carry the tempo map, between two of them it is linear
+    const LyricsTiming &a = *(it - 1);
+    if (it == timeline.constEnd() || it->tick == a.tick)
+        return a.start;
+
+    return a.start + static_cast<long>(static_cast<qint64>(it->start - a.start) * (tick - a.tick) / (it->tick - a.tick));
 }
 
-void LyricsWidget::drawCursorTextToPixmap(QPixmap *pix, const QString &text)
+void LyricsWidget::showLine(int line)
 {
-    pix->fill(Qt::transparent);
-    QPainter p(pix);
-    p.setRenderHints(QPainter::Antialiasing);
+    // a line is on line 1 when it is even, the next one is on the other
+    bool first = line % 2 == 0;
+    int l1 = first ? line : line + 1;
+    int l2 = first ? line + 1 : line;
 
-    QFont f = autoFontSize ? getPerfectFont(text) : font();
-    QPainterPath path;
-    path.addText(getAllBorderSize(), f.pointSize() * 2, f, text);
-
-    if (cBorderOutWidth > 0) {
-        int w = cBorderOutWidth + cBorderWidth;
-        QPen pen(cBorderOutColor, w, Qt::SolidLine, Qt::SquareCap, Qt::RoundJoin);
-        p.setPen(pen);
-        p.setBrush(cBorderOutColor);
-        p.drawPath(path);
+    bool changed = first != isLine1;
+
+    if (l1 != line1Index) {
+        line1Index = l1;
+        setTextLine1(l1 < lyrics.count() ? lyrics.at(l1) : "", false);
+        changed = true;
     }
 
-    if (cBorderWidth > 0) {
-        int w = cBorderWidth;
-        QPen pen(cBorderColor, w, Qt::SolidLine, Qt::SquareCap, Qt::RoundJoin);
-        p.setPen(pen);
-        p.setBrush(cBorderColor);
-        p.drawPath(path);
+    if (l2 != line2Index) {
+        line2Index = l2;
+        setTextLine2(l2 < lyrics.count() ? lyrics.at(l2) : "", false);
+        changed = true;
     }
 
-    p.setBrush(cColor);
-    p.setPen(Qt::NoPen);
+    if (!changed)
+        return;
+
+    isLine1 = first;
+    linesIndex = line + 2;
+    updateArea = calculateUpdateArea();
+
+    prerenderAhead();
+    update();
+}
+
+LineColors LyricsWidget::textColors()
+{
+    LineColors c;
+    c.color = tColor;
+    c.borderColor = tBorderColor;
+    c.borderOutColor = tBorderOutColor;
+    c.borderWidth = tBorderWidth;
+    c.borderOutWidth = tBorderOutWidth;
+    return c;
+}
+
+LineColors LyricsWidget::cursorColors()
+{
+    LineColors c;
+    c.color = cColor;
+    c.borderColor = cBorderColor;
+    c.borderOutColor = cBorderOutColor;
+    c.borderWidth = cBorderWidth;
+    c.borderOutWidth = cBorderOutWidth;
+    return c;
+}
+
+LineJob LyricsWidget::lineJob(const QString &text)
+{
+    // fonts and sizes are worked out here, the fit uses the widget
+    LineJob job;
+    job.text = text;
+    job.font = autoFontSize ? getPerfectFont(text) : font();
+    job.size = calculateLineSize(text);
+    job.x = getAllBorderSize();
+    job.plain = textColors();
+    job.cursor = cursorColors();
+    return job;
+}
+
+void LyricsWidget::invalidatePrerender()
+{
+    renderGen++;
+    renderer->setGeneration(renderGen);
+    timelineDirty = true;
 
-    //p.drawPath(path);
-    p.fillPath(path, cColor);
+    prerendered.clear();
+    prerendering.clear();
+}
 
-    /*if (cBorderWidth > 0) {
+void LyricsWidget::prerenderAhead()
+{
+    QSet<QString> window;
+    for (int i=linesIndex; i<lyrics.count() && i<linesIndex + PRERENDER_LINES; i++) {
+        const QString &text = lyrics.at(i);
+        if (text.trimmed().isEmpty())
+            continue;
 
-        QPen pen(Qt::red, cBorderWidth * 2, Qt::SolidLine, Qt::SquareCap, Qt::RoundJoin);
-        QPainterPathStroker stroker(pen);
-        QPainterPath strokedPath = stroker.createStroke(path);
+        window.insert(text);
 
-        if (cBorderOutWidth > 0)
-            p.setPen(QPen(cBorderOutColor, cBorderOutWidth));
-        p.setBrush(cBorderColor);
-        p.drawPath(strokedPath.subtracted(path));
+        if (prerendered.contains(text) || prerendering.contains(text))
+            continue;
 
-        //QPen pen(cBorderColor, cBorderWidth);
-        //p.strokePath(path.simplified(), pen);
-    }*/
+        prerendering.insert(text);
+        emit renderRequested(renderGen, lineJob(text));
+    }
 
-    p.end();
+    // only the lines ahead are kept, a chorus coming back is drawn again
+    for (QHash<QString, LineImages>::iterator it = prerendered.begin(); it != prerendered.end(); ) {
+        if (window.contains(it.key()))
+            ++it;
+        else
+            it = prerendered.erase(it);
+    }
 }
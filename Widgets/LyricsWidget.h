@@ -2,7 +2,11 @@
 #define LYRICSWIDGET_H
 
 #include <QWidget>
-#include <QVariantAnimation>
+#include <QHash>
+#include <QSet>
+#include <QVector>
+
+#include "LyricsRenderer.h"
 
 enum class LinePosition {
     Center,
@@ -10,6 +14,17 @@ enum class LinePosition {
     Right
 };
 
+// what is shown from one cursor until the next
+typedef struct
+{
+    int line;       // the highlighted line
+    int ch;         // the character wiped, -1 before the line, its length after
+    long tick;
+    long start;     // ms
+    long end;       // ms, the wipe is done
+    int x0, x1;     // the highlight grows from x0 to x1
+} LyricsTiming;
+
 class LyricsWidget : public QWidget
 {
     Q_OBJECT
@@ -18,12 +33,20 @@ public:
     ~LyricsWidget();
 
     void reset();
-    void setLyrics(const QString &lyr, const QList<long> &curs);
+    // times are the ms of each cursor, without them the ticks are used
+    void setLyrics(const QString &lyr, const QVector<long> &curs,
+                   const QVector<long> &times = QVector<long>());
     void setPositionCursor(int tick);
     void setSeekPositionCursor(int tick);
+    // the lines and the highlight are a function of the time only
+    void setPositionMs(long ms);
 
     QString lyrData() { return lyrics.join("\r\n"); }
-    QList<long> curData() { return cursors; }
+    QVector<long> curData() { return cursors; }
+    QVector<long> curTimes();
+
+    // the line pixmaps and the lines drawn ahead
+    qint64 cacheBytes();
 
     QFont   textFont()          { return font(); }
     QColor  textColor()         { return tColor; }
@@ -54,7 +77,7 @@ public:
     void setAnimationTime(int t);
 
     bool isAutoFontSize() { return autoFontSize; }
-    void setAutoFontSize(bool a) { autoFontSize = a; }
+    void setAutoFontSize(bool a) { autoFontSize = a; invalidatePrerender(); }
 
     LinePosition line1Position() { return line1_p; }
     LinePosition line2Position() { return line2_p; }
@@ -71,23 +94,22 @@ public:
     void setTextLine1(const QString &text, bool andUpdate = true);
     void setTextLine2(const QString &text, bool andUpdate = true);
 
-    int  animationTime()         { return animation->duration(); }
-    void stopAnimation()         { animation->stop(); }
+    // the longest wipe of one character
+    int  animationTime()         { return wipeTime; }
 
 public slots:
 
 signals:
+    void renderRequested(int gen, const LineJob &job);
 
 protected:
     void resizeEvent(QResizeEvent *event);
     void paintEvent(QPaintEvent *event);
 
 private slots:
-    void onAnimationValueChanged(const QVariant &v);
+    void onLineRendered(int gen, const QString &text, const LineImages &images);
 
 private:
-    QVariantAnimation *animation;
-
     QString tLine1, tLine2;
     QPixmap pixLine1, pixLine2;
     QPixmap pixCurLine1, pixCurLine2;
@@ -99,17 +121,18 @@ private:
     int line2_y = 100;  // from bottom
 
     QStringList lyrics;
-    QList<long> cursors;
+    QVector<long> cursors;
     bool isLine1 = true;
     bool autoFontSize = true;
-    int linesIndex = 0;
+    int linesIndex = 0;     // the first line not on the screen
+    int line1Index = -1, line2Index = -1;
+
+    // one timing per cursor, sorted by tick and by time
+    QVector<LyricsTiming> timeline;
+    bool timelineDirty = false;
+    int wipeTime = 300;
 
-    QList<int> chars_width; // In current line
-    int char_index = 0; // In current line
-    int cursor_index = 0;
     int cursor_width = 0;  // current cursor position
-    int cursor_toEnd = 0;
-    bool at_end_line = false;
 
     int tBorderWidth = 2, tBorderOutWidth = 1;
     int cBorderWidth = 3, cBorderOutWidth = 1;
@@ -119,8 +142,24 @@ private:
 
     QRect updateArea;
 
-    QList<int> getCharsWidth();
+    QHash<QString, QList<int>> advanceCache;
+    const int ADVANCE_CACHE_SIZE = 512;
+
+    // the next lines are drawn on the render thread before they are shown
+    LyricsRenderer *renderer;
+    QHash<QString, LineImages> prerendered;
+    QSet<QString> prerendering;
+    int renderGen = 0;
+    const int PRERENDER_LINES = 4;
+
+    // auto font size of each line, for fitWidth and fitFontKey
+    QHash<QString, int> fitSizes;
+    int fitWidth = -1;
+    QString fitFontKey;
+
     QList<int> getCharsWidth(const QString &text);
+    // x after each character without the border, one layout per (font, text)
+    QList<int> getCharsAdvance(const QFont &f, const QString &text);
     QRect calculateUpdateArea();
     QSize calculateLineSize(const QString &text);
 
@@ -129,8 +168,19 @@ private:
     QPoint getLine1Point();
     QPoint getLine2Point();
 
-    void drawTextToPixmap(QPixmap *pix, const QString &text);
-    void drawCursorTextToPixmap(QPixmap *pix, const QString &text);
+    void buildTimeline(const QVector<long> &times);
+    // the x of the timings, they follow the style and the size
+    void layoutTimeline();
+    void updateEnds();
+    long msFromTick(long tick);
+    void showLine(int line);
+
+    LineColors textColors();
+    LineColors cursorColors();
+    LineJob lineJob(const QString &text);
+    // after a change of the style or the size, the drawn lines are old
+    void invalidatePrerender();
+    void prerenderAhead();
 };
 
 #endif // LYRICSWIDGET_H
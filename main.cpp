@@ -106,6 +106,11 @@ int main(int argc, char *argv[])
 void registerMetaType()
 {
     qRegisterMetaType<InstrumentType>("InstrumentType");
+    qRegisterMetaType<SearchType>("SearchType");
+    qRegisterMetaType<SongRecord>("SongRecord");
+    qRegisterMetaType<QList<qint64>>("QList<qint64>");
+    qRegisterMetaType<LineJob>("LineJob");
+    qRegisterMetaType<LineImages>("LineImages");
 
     //<QList<int>>("QList<int>");
     qRegisterMetaTypeStreamOperators<QList<int>>("QList<int>");